@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dodo
+{
+
+    struct Args : public std::vector<std::string_view>
+    {
+        explicit Args(std::vector<std::string_view> args) noexcept : std::vector<std::string_view>(args) {}
+
+        // Same as Args::from_argc_argv_skip_program_name(argc, argv)
+        explicit Args(int argc, char const * const argv[]) noexcept : std::vector<std::string_view>(argv + 1, argv + argc) {}
+
+        static Args from_argc_argv(int argc, char const * const argv[]) noexcept { return Args(std::vector<std::string_view>(argv, argv + argc)); }
+        static Args from_argc_argv_skip_program_name(int argc, char const * const argv[]) noexcept { return Args(argc, argv); }
+
+        static Args from_command_line(std::string command_line);
+        static Args from_command_line_skip_program_name(std::string command_line);
+
+        // Splits a batch of command lines separated by the given separator, such as "set fov 90; set gamma 2.2", and parses each line
+        // as with Args::from_command_line. Separators between quotes or escaped with backslash do not split. Empty lines are skipped.
+        static std::vector<Args> batch_from_command_line(std::string_view command_lines, char separator = ';');
+
+        // Arguments parsed from a command line point into the buffer, so they are made to point into the buffer of the copy.
+        Args(Args const & other);
+        Args(Args && other) noexcept;
+        Args & operator = (Args const & other);
+        Args & operator = (Args && other) noexcept;
+
+    private:
+        std::string buffer;
+        Args() noexcept = default;
+
+        void rebase(char const * old_buffer, size_t old_buffer_size) noexcept;
+    };
+
+    struct ArgsView : public std::span<std::string_view const>
+    {
+        ArgsView(Args const & args) noexcept : std::span<std::string_view const>(args.begin(), args.end()) {}
+        constexpr ArgsView(std::span<std::string_view const> args) noexcept : std::span<std::string_view const>(args) {}
+    };
+
+    namespace detail
+    {
+        template <std::predicate<char> P>
+        inline void next_word_unscaped(std::string_view in, size_t & i, char out[], size_t & out_i, P is_delimiter)
+        {
+            while (i < in.size())
+            {
+                char const c = in[i++];
+
+                if (is_delimiter(c))
+                    break;
+                else
+                    out[out_i++] = c;
+            }
+        }
+
+        template <std::predicate<char> P>
+        inline void next_word(std::string_view in, size_t & i, char out[], size_t & out_i, P is_delimiter)
+        {
+            while (i < in.size())
+            {
+                char const c = in[i++];
+
+                if (is_delimiter(c))
+                    break;
+
+                // Escaping with \ backslash
+                else if (c == '\\')
+                {
+                    // A backslash at the end escapes nothing and is dropped.
+                    if (i < in.size())
+                        out[out_i++] = in[i++];
+                }
+                // Escaping with "double quotes" or 'single quotes'
+                else if (c == '"')
+                {
+                    next_word_unscaped(in, i, out, out_i, [](char c) { return c == '"'; });
+                }
+                else if (c == '\'')
+                {
+                    next_word_unscaped(in, i, out, out_i, [](char c) { return c == '\''; });
+                }
+                else
+                {
+                    out[out_i++] = c;
+                }
+            }
+        }
+    } // namespace detail
+
+    inline Args Args::from_command_line(std::string command_line)
+    {
+        Args args;
+        args.buffer = std::move(command_line);
+
+        size_t i = 0;
+        size_t out_i = 0;
+
+        while (i < args.buffer.size())
+        {
+            size_t const next_word_start = out_i;
+            detail::next_word(args.buffer, i, args.buffer.data(), out_i, [](char c) { return c == ' ' || c == '\t' || c == '\n'; });
+            size_t const next_word_end = out_i;
+
+            size_t const next_word_length = next_word_end - next_word_start;
+            if (next_word_length > 0)
+                args.emplace_back(args.buffer.data() + next_word_start, next_word_length);
+        }
+
+        return args;
+    }
+
+    inline Args Args::from_command_line_skip_program_name(std::string command_line)
+    {
+        Args args;
+        args.buffer = std::move(command_line);
+
+        size_t i = 0;
+        size_t out_i = 0;
+
+        constexpr auto is_whitespace = [](char c) { return c == ' ' || c == '\t' || c == '\n'; };
+
+        // The program name is unescaped into the start of the buffer and then dropped, so the words after it overwrite it.
+        while (out_i == 0 && i < args.buffer.size())
+            detail::next_word(args.buffer, i, args.buffer.data(), out_i, is_whitespace);
+        out_i = 0;
+
+        while (i < args.buffer.size())
+        {
+            size_t const next_word_start = out_i;
+            detail::next_word(args.buffer, i, args.buffer.data(), out_i, is_whitespace);
+            size_t const next_word_end = out_i;
+
+            size_t const next_word_length = next_word_end - next_word_start;
+            if (next_word_length > 0)
+                args.emplace_back(args.buffer.data() + next_word_start, next_word_length);
+        }
+
+        return args;
+    }
+
+    inline std::vector<Args> Args::batch_from_command_line(std::string_view command_lines, char separator)
+    {
+        std::vector<Args> batch;
+
+        size_t line_start = 0;
+        size_t i = 0;
+        while (i <= command_lines.size())
+        {
+            if (i == command_lines.size() || command_lines[i] == separator)
+            {
+                Args args = from_command_line(std::string(command_lines.substr(line_start, i - line_start)));
+                if (!args.empty())
+                    batch.push_back(std::move(args));
+
+                line_start = ++i;
+            }
+            // Same escaping rules as detail::next_word.
+            else if (command_lines[i] == '\\')
+            {
+                // A backslash at the end must not skip past it, so that the last line is still flushed.
+                i = std::min(i + 2, command_lines.size());
+            }
+            else if (command_lines[i] == '"' || command_lines[i] == '\'')
+            {
+                size_t const closing_quote = command_lines.find(command_lines[i], i + 1);
+                i = closing_quote == std::string_view::npos ? command_lines.size() : closing_quote + 1;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        return batch;
+    }
+
+    inline Args::Args(Args const & other)
+        : std::vector<std::string_view>(other)
+        , buffer(other.buffer)
+    {
+        rebase(other.buffer.data(), other.buffer.size());
+    }
+
+    inline Args::Args(Args && other) noexcept
+        : std::vector<std::string_view>(std::move(other))
+    {
+        // Small strings are stored in the string object, so moving the buffer may change where the characters are.
+        char const * const old_buffer = other.buffer.data();
+        size_t const old_buffer_size = other.buffer.size();
+        buffer = std::move(other.buffer);
+        rebase(old_buffer, old_buffer_size);
+    }
+
+    inline Args & Args::operator = (Args const & other)
+    {
+        if (this != &other)
+            *this = Args(other);
+        return *this;
+    }
+
+    inline Args & Args::operator = (Args && other) noexcept
+    {
+        if (this != &other)
+        {
+            char const * const old_buffer = other.buffer.data();
+            size_t const old_buffer_size = other.buffer.size();
+            static_cast<std::vector<std::string_view> &>(*this) = std::move(other);
+            buffer = std::move(other.buffer);
+            rebase(old_buffer, old_buffer_size);
+        }
+        return *this;
+    }
+
+    inline void Args::rebase(char const * old_buffer, size_t old_buffer_size) noexcept
+    {
+        std::less_equal<char const *> const less_equal;
+        for (std::string_view & arg : *this)
+            if (less_equal(old_buffer, arg.data()) && less_equal(arg.data() + arg.size(), old_buffer + old_buffer_size))
+                arg = std::string_view(buffer.data() + (arg.data() - old_buffer), arg.size());
+    }
+
+} // namespace dodo
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "dodo.hh"
+#include <chrono>
+#include <concepts>
+#include <deque>
+
+namespace dodo
+{
+
+    // Queue of command lines that are parsed and dispatched a few at a time, so that a burst of commands, for example from a script run in
+    // a game console, is spread over several frames instead of causing a hitch. Each tick parses and dispatches queued commands until its
+    // time budget, measured with a monotonic clock, runs out, and leaves the rest for the next tick.
+    template <Parser P>
+    struct CommandScheduler
+    {
+        using clock = std::chrono::steady_clock;
+        using parse_result_type = typename P::parse_result_type;
+
+        struct statistics
+        {
+            size_t queue_depth = 0;             // Commands waiting to be dispatched.
+            size_t max_queue_depth = 0;
+            size_t dispatched = 0;              // Commands dispatched since the scheduler was created.
+            size_t ticks = 0;
+            size_t budget_overruns = 0;         // Ticks that took longer than their budget.
+            clock::duration longest_tick = {};
+        };
+
+        constexpr explicit CommandScheduler(P parser_) noexcept : parser(std::move(parser_)) {}
+
+        void push(Args args)
+        {
+            queue.push_back(std::move(args));
+            current_stats.max_queue_depth = std::max(current_stats.max_queue_depth, queue.size());
+        }
+
+        void push(std::string command_line)
+        {
+            push(Args::from_command_line(std::move(command_line)));
+        }
+
+        // Parses and dispatches queued commands in order, calling handler with the result of parsing each, until the budget runs out or
+        // the queue is empty. At least one command is dispatched per tick even if it takes longer than the budget, so the queue always
+        // makes progress. Returns the number of commands dispatched.
+        template <std::invocable<expected<parse_result_type, std::string>> Handler>
+        size_t tick(clock::duration budget, Handler && handler)
+        {
+            clock::time_point const start = clock::now();
+            clock::duration elapsed = clock::duration::zero();
+            size_t dispatched = 0;
+
+            while (!queue.empty() && (dispatched == 0 || elapsed < budget))
+            {
+                Args const args = std::move(queue.front());
+                queue.pop_front();
+
+                handler(parser.parse(args));
+                ++dispatched;
+                elapsed = clock::now() - start;
+            }
+
+            ++current_stats.ticks;
+            current_stats.dispatched += dispatched;
+            current_stats.longest_tick = std::max(current_stats.longest_tick, elapsed);
+            if (elapsed > budget)
+                ++current_stats.budget_overruns;
+
+            return dispatched;
+        }
+
+        bool empty() const noexcept { return queue.empty(); }
+
+        statistics stats() const noexcept
+        {
+            statistics result = current_stats;
+            result.queue_depth = queue.size();
+            return result;
+        }
+
+        P parser;
+
+    private:
+        std::deque<Args> queue;
+        statistics current_stats;
+    };
+
+} // namespace dodo
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace dodo
+{
+
+    // Discriminated union of Ts... that only takes as much memory as the alternative it actually holds.
+    // Alternatives small enough to fit in the inline buffer are stored in place. Bigger alternatives are allocated with their
+    // exact size from a memory resource, which may be an arena such as std::pmr::monotonic_buffer_resource.
+    template <typename ... Ts>
+    struct compact_variant
+    {
+        static constexpr size_t inline_capacity = 4 * sizeof(void *);
+
+        template <size_t I>
+        using alternative = std::variant_alternative_t<I, std::variant<Ts...>>;
+
+        template <typename T>
+        static constexpr bool fits_inline =
+            sizeof(T) <= inline_capacity &&
+            alignof(T) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible_v<T>;
+
+        template <size_t I, typename ... Args>
+        explicit compact_variant(std::in_place_index_t<I>, std::pmr::memory_resource * resource_, Args && ... args)
+            : resource(resource_)
+        {
+            construct<I>(std::forward<Args>(args)...);
+        }
+
+        compact_variant(compact_variant const & other) : resource(other.resource)
+        {
+            for_active_index(other.active_index, [&](auto i) { construct<i>(other.template get<i>()); });
+        }
+
+        compact_variant(compact_variant && other) noexcept : resource(other.resource)
+        {
+            steal(other);
+        }
+
+        compact_variant & operator = (compact_variant const & other)
+        {
+            if (this != &other)
+                *this = compact_variant(other);
+            return *this;
+        }
+
+        compact_variant & operator = (compact_variant && other) noexcept
+        {
+            if (this != &other)
+            {
+                destroy();
+                resource = other.resource;
+                steal(other);
+            }
+            return *this;
+        }
+
+        ~compact_variant()
+        {
+            destroy();
+        }
+
+        // Index of the alternative held. std::variant_npos if the variant has been moved from.
+        constexpr size_t index() const noexcept { return active_index; }
+
+        bool is_stored_inline() const noexcept
+        {
+            bool result = false;
+            for_active_index(active_index, [&](auto i) { result = fits_inline<alternative<i>>; });
+            return result;
+        }
+
+        template <size_t I> alternative<I> & get() & noexcept { assert(active_index == I); return *pointer<I>(); }
+        template <size_t I> alternative<I> const & get() const & noexcept { assert(active_index == I); return *pointer<I>(); }
+        template <size_t I> alternative<I> && get() && noexcept { assert(active_index == I); return std::move(*pointer<I>()); }
+
+        template <size_t I> alternative<I> * get_if() noexcept { return active_index == I ? pointer<I>() : nullptr; }
+        template <size_t I> alternative<I> const * get_if() const noexcept { return active_index == I ? pointer<I>() : nullptr; }
+
+        // Calls the visitor with the alternative held. Throws std::bad_variant_access if the variant has been moved from, as std::visit does.
+        template <typename Visitor>
+        decltype(auto) visit(Visitor && visitor) &
+        {
+            return visit_impl(*this, visitor, std::index_sequence_for<Ts...>());
+        }
+
+        template <typename Visitor>
+        decltype(auto) visit(Visitor && visitor) const &
+        {
+            return visit_impl(*this, visitor, std::index_sequence_for<Ts...>());
+        }
+
+    private:
+        template <typename F>
+        static void for_active_index(size_t index, F && f)
+        {
+            [&]<size_t ... Is>(std::index_sequence<Is...>)
+            {
+                static_cast<void>(((Is == index ? (f(std::integral_constant<size_t, Is>()), true) : false) || ...));
+            }(std::index_sequence_for<Ts...>());
+        }
+
+        template <size_t I, typename Self, typename Visitor>
+        static decltype(auto) visit_alternative(Self & self, Visitor & visitor)
+        {
+            return std::invoke(visitor, *self.template pointer<I>());
+        }
+
+        template <typename Self, typename Visitor, size_t ... Is>
+        static decltype(auto) visit_impl(Self & self, Visitor & visitor, std::index_sequence<Is...>)
+        {
+            using Result = decltype(visit_alternative<0>(self, visitor));
+            constexpr Result (*table[])(Self &, Visitor &) = { &visit_alternative<Is, Self, Visitor>... };
+            if (self.active_index == std::variant_npos)
+                throw std::bad_variant_access();
+            return table[self.active_index](self, visitor);
+        }
+
+        template <size_t I>
+        alternative<I> * pointer() noexcept
+        {
+            if constexpr (fits_inline<alternative<I>>)
+                return std::launder(reinterpret_cast<alternative<I> *>(storage.buffer));
+            else
+                return static_cast<alternative<I> *>(storage.heap_object);
+        }
+
+        template <size_t I>
+        alternative<I> const * pointer() const noexcept
+        {
+            return const_cast<compact_variant *>(this)->pointer<I>();
+        }
+
+        template <size_t I, typename ... Args>
+        void construct(Args && ... args)
+        {
+            using T = alternative<I>;
+
+            if constexpr (fits_inline<T>)
+            {
+                new (storage.buffer) T(std::forward<Args>(args)...);
+            }
+            else
+            {
+                void * const memory = resource->allocate(sizeof(T), alignof(T));
+                try
+                {
+                    storage.heap_object = new (memory) T(std::forward<Args>(args)...);
+                }
+                catch (...)
+                {
+                    resource->deallocate(memory, sizeof(T), alignof(T));
+                    throw;
+                }
+            }
+
+            active_index = I;
+        }
+
+        // Takes the value of other, which is left valueless. Assumes this holds no value.
+        void steal(compact_variant & other) noexcept
+        {
+            for_active_index(other.active_index, [&](auto i)
+            {
+                using T = alternative<i>;
+                if constexpr (fits_inline<T>)
+                {
+                    new (storage.buffer) T(std::move(*other.template pointer<i>()));
+                    other.pointer<i>()->~T();
+                }
+                else
+                {
+                    storage.heap_object = other.storage.heap_object;
+                }
+            });
+
+            active_index = other.active_index;
+            other.active_index = std::variant_npos;
+        }
+
+        void destroy() noexcept
+        {
+            for_active_index(active_index, [&](auto i)
+            {
+                using T = alternative<i>;
+                pointer<i>()->~T();
+                if constexpr (!fits_inline<T>)
+                    resource->deallocate(storage.heap_object, sizeof(T), alignof(T));
+            });
+
+            active_index = std::variant_npos;
+        }
+
+        union
+        {
+            alignas(std::max_align_t) std::byte buffer[inline_capacity];
+            void * heap_object;
+        } storage;
+        std::pmr::memory_resource * resource;
+        size_t active_index = std::variant_npos;
+    };
+
+} // namespace dodo
@@ -0,0 +1,427 @@
+#pragma once
+
+#include "args.hh"
+#include "prefix_trie.hh"
+#include "sink.hh"
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace dodo
+{
+
+    enum struct completion_kind : uint8_t { command, option, value };
+
+    struct completion_candidate
+    {
+        completion_kind kind = completion_kind::command;
+        std::string_view text;
+        std::string_view description;
+        std::string_view option;        // For values, pattern of the option they are given to. Empty otherwise.
+    };
+
+    // Writes the word the candidate completes, which is "--color=red" for the value "red" of the option "--color".
+    template <Sink S>
+    constexpr void write_completion(S & sink, completion_candidate const & candidate)
+    {
+        if (!candidate.option.empty())
+        {
+            sink.write(candidate.option);
+            sink.write("=");
+        }
+        sink.write(candidate.text);
+    }
+
+    // Context that follows no candidate.
+    constexpr uint32_t no_completion_context = ~uint32_t(0);
+
+    // Value provider of an option that has none.
+    constexpr uint32_t no_value_provider = ~uint32_t(0);
+
+    // Values that an option can take that are known at compile time, such as the names of the enumerators of an enum. They are stored in
+    // the completion index, so completion files have them too.
+    struct completion_values
+    {
+        std::span<std::string_view const> values;
+    };
+
+    // Values of an option that can only be known when completing, such as paths or the identifiers of running jobs. The provider appends
+    // to the candidates the values that may complete the value given, and candidates that do not start with it are discarded. They are
+    // only completed by programs that answer completion requests themselves, since the completion helper does not have the providers.
+    template <typename P>
+    concept DynamicCompletionProvider = requires(P const & provider, std::string_view value, std::vector<std::string> & candidates) {
+        provider(value, candidates);
+    };
+
+    template <typename P>
+    concept CompletionProvider = std::same_as<std::remove_cvref_t<P>, completion_values> || DynamicCompletionProvider<P>;
+
+    // Number of trie nodes and candidates, for sizing a completion_index.
+    struct completion_index_size
+    {
+        constexpr uint32_t add_context() noexcept
+        {
+            nodes += 2;
+            return uint32_t(contexts++);
+        }
+
+        constexpr void insert(uint32_t, completion_candidate const & candidate, uint32_t = no_completion_context, uint32_t = no_value_provider) noexcept
+        {
+            ++candidates;
+            nodes += candidate.text.size();
+        }
+
+        template <DynamicCompletionProvider Provider>
+        constexpr uint32_t add_value_provider(Provider const &) noexcept
+        {
+            return value_providers++;
+        }
+
+        size_t contexts = 1;
+        size_t candidates = 0;
+        size_t nodes = 3;
+        uint32_t value_providers = 0;
+    };
+
+    // Value provider that needs to be called to complete the value of an option.
+    struct value_provider_request
+    {
+        uint32_t provider = no_value_provider;
+        std::string_view option;    // Pattern of the option, as written.
+        std::string_view value;     // Part of the value that has been written.
+    };
+
+    namespace detail
+    {
+        // Contexts are subtrees of the trie below a key of two characters.
+        struct completion_context_key
+        {
+            constexpr explicit completion_context_key(uint32_t context) noexcept
+                : characters{char((context >> 8) & 0xFF), char(context & 0xFF)}
+            {}
+
+            constexpr std::string_view view() const noexcept { return std::string_view(characters, 2); }
+
+            char characters[2];
+        };
+
+        // Candidate that is exactly the word in the context, or no_completion_context.
+        template <typename Completions>
+        constexpr uint32_t find_completion(Completions const & completions, uint32_t context, std::string_view word) noexcept
+        {
+            if (word.empty())
+                return no_completion_context;
+
+            uint32_t const node = completions.find_node(word, completions.context_root(context));
+            if (node == 0 || !completions.is_word_end(node))
+                return no_completion_context;
+
+            return completions.word_value(node);
+        }
+
+        template <typename Completions, typename F>
+        constexpr void for_each_completion_below(Completions const & completions, uint32_t node, F && f)
+        {
+            if (completions.is_word_end(node))
+                f(completions.word_value(node));
+
+            for (uint32_t child = completions.first_child(node); child != 0; child = completions.next_sibling(child))
+                for_each_completion_below(completions, child, f);
+        }
+
+        struct completion_position
+        {
+            uint32_t context = 0;
+            uint32_t option = no_completion_context;    // Candidate of the option whose value is being written, if any.
+            std::string_view option_text;
+            std::string_view word;                      // Part of the word that is being completed in the context.
+        };
+
+        // Context of the word being written. The commands in the words that precede it choose the context, and a word with an equals sign
+        // is a value of the option before it.
+        template <typename Completions>
+        constexpr completion_position find_completion_position(Completions const & completions, std::span<std::string_view const> preceding_words, std::string_view word) noexcept
+        {
+            completion_position position;
+            for (std::string_view const preceding : preceding_words)
+            {
+                uint32_t const found = find_completion(completions, position.context, preceding);
+                if (found != no_completion_context && completions.candidate(found).kind == completion_kind::command && completions.next_context(found) != no_completion_context)
+                    position.context = completions.next_context(found);
+            }
+
+            position.word = word;
+            size_t const equals = word.find('=');
+            if (equals != std::string_view::npos)
+            {
+                position.option_text = word.substr(0, equals);
+                position.option = find_completion(completions, position.context, position.option_text);
+                if (position.option != no_completion_context && completions.candidate(position.option).kind != completion_kind::option)
+                    position.option = no_completion_context;
+
+                position.context = position.option == no_completion_context ? no_completion_context : completions.next_context(position.option);
+                position.word.remove_prefix(equals + 1);
+            }
+
+            return position;
+        }
+
+        // Completion over a trie of contexts, which may be a completion_index or a file it was saved to.
+        template <typename Completions>
+        std::vector<completion_candidate> complete(Completions const & completions, std::span<std::string_view const> preceding_words, std::string_view word)
+        {
+            completion_position const position = find_completion_position(completions, preceding_words, word);
+            if (position.context == no_completion_context)
+                return {};
+
+            std::vector<completion_candidate> results;
+            uint32_t const root = completions.context_root(position.context);
+            uint32_t const node = root == 0 ? 0 : completions.find_node(position.word, root);
+            if (node != 0)
+            {
+                for_each_completion_below(completions, node, [&](uint32_t candidate)
+                {
+                    results.push_back(completions.candidate(candidate));
+                    results.back().option = position.option_text;
+                });
+            }
+
+            std::sort(results.begin(), results.end(), [](completion_candidate const & a, completion_candidate const & b) { return a.text < b.text; });
+            return results;
+        }
+    }
+
+    // Words that can be completed at each point of a command line, which can be built at compile time. Words are grouped by context:
+    // context 0 has what can start a command line, each command has a context with the options and commands of its parser, and each
+    // option with a known set of values has a context with them, which are completed after "--option=".
+    // Contexts share a single trie, below a key of two characters each, so finding the candidates for a word only takes walking it.
+    template <size_t NodeCapacity, size_t CandidateCapacity>
+    struct completion_index
+    {
+        constexpr completion_index() noexcept
+        {
+            add_context();
+        }
+
+        // Returns the new context.
+        constexpr uint32_t add_context() noexcept
+        {
+            assert(context_count <= 0xFFFF);
+            uint32_t const context = context_count++;
+            trie.add_path(detail::completion_context_key(context).view(), context);
+            return context;
+        }
+
+        // Candidates that are completed in next_context once they have been written, such as a command, which is followed by its options.
+        // Options may have a value provider instead, which is called to complete their values.
+        constexpr void insert(uint32_t context, completion_candidate const & candidate, uint32_t next_context = no_completion_context, uint32_t value_provider = no_value_provider) noexcept
+        {
+            assert(candidate_count < CandidateCapacity);
+            candidates[candidate_count] = candidate;
+            next_contexts[candidate_count] = next_context;
+            value_providers[candidate_count] = value_provider;
+            trie.insert(candidate.text, uint32_t(candidate_count), context_root(context));
+            ++candidate_count;
+        }
+
+        // Providers are numbered in the order they are added. The index only keeps their number.
+        template <DynamicCompletionProvider Provider>
+        constexpr uint32_t add_value_provider(Provider const &) noexcept
+        {
+            return value_provider_count++;
+        }
+
+        // Candidates for the word being written, given the words before it. The commands in the words that precede it choose the context,
+        // and a word with an equals sign completes the values of the option before it. Candidates are sorted by text.
+        std::vector<completion_candidate> complete(std::span<std::string_view const> preceding_words, std::string_view word) const
+        {
+            return detail::complete(*this, preceding_words, word);
+        }
+
+        // Provider to call for the word being written, if it is the value of an option that has one.
+        constexpr std::optional<value_provider_request> find_value_provider(std::span<std::string_view const> preceding_words, std::string_view word) const noexcept
+        {
+            detail::completion_position const position = detail::find_completion_position(*this, preceding_words, word);
+            if (position.option == no_completion_context || value_providers[position.option] == no_value_provider)
+                return std::nullopt;
+
+            return value_provider_request{value_providers[position.option], position.option_text, position.word};
+        }
+
+        // Access to the trie for detail::complete.
+        constexpr uint32_t context_root(uint32_t context) const noexcept
+        {
+            return trie.find_node(detail::completion_context_key(context).view());
+        }
+
+        constexpr uint32_t find_node(std::string_view prefix, uint32_t root) const noexcept { return trie.find_node(prefix, root); }
+        constexpr bool is_word_end(uint32_t node) const noexcept { return trie.nodes[node].is_word_end; }
+        constexpr uint32_t word_value(uint32_t node) const noexcept { return trie.nodes[node].word_value; }
+        constexpr uint32_t first_child(uint32_t node) const noexcept { return trie.nodes[node].first_child; }
+        constexpr uint32_t next_sibling(uint32_t node) const noexcept { return trie.nodes[node].next_sibling; }
+        constexpr completion_candidate candidate(uint32_t index) const noexcept { return candidates[index]; }
+        constexpr uint32_t next_context(uint32_t index) const noexcept { return next_contexts[index]; }
+
+        prefix_trie<NodeCapacity> trie;
+        completion_candidate candidates[CandidateCapacity > 0 ? CandidateCapacity : 1] = {};
+        uint32_t next_contexts[CandidateCapacity > 0 ? CandidateCapacity : 1] = {};
+        uint32_t value_providers[CandidateCapacity > 0 ? CandidateCapacity : 1] = {};
+        size_t candidate_count = 0;
+        uint32_t context_count = 0;
+        uint32_t value_provider_count = 0;
+    };
+
+    // Argument a program is called with to ask it for completions, followed by the command line up to the cursor.
+    constexpr std::string_view completion_request = "__complete";
+
+    namespace detail
+    {
+        // Command line of a completion request, split in the words before the cursor and the word being written.
+        struct completion_words
+        {
+            std::span<std::string_view const> preceding() const noexcept
+            {
+                return new_word ? std::span<std::string_view const>(words) : std::span<std::string_view const>(words).first(words.size() - 1);
+            }
+
+            std::string_view current() const noexcept { return new_word ? std::string_view() : words.back(); }
+
+            // Then there is nothing to complete.
+            bool writing_program_name() const noexcept { return !new_word && words.empty(); }
+
+            Args words;
+            bool new_word;
+        };
+
+        inline std::optional<completion_words> split_completion_request(ArgsView args)
+        {
+            if (args.size() == 0 || args[0] != completion_request)
+                return std::nullopt;
+
+            // The command line starts with the name of the program. A command line that ends in whitespace is starting a new word.
+            // A blank command line has no program name yet, so there is nothing to complete.
+            std::string_view const command_line = args.size() > 1 ? args[1] : std::string_view();
+            if (command_line.find_first_not_of(" \t\n") == std::string_view::npos)
+                return completion_words{Args::from_command_line(std::string()), false};
+
+            bool const new_word = command_line.empty() || command_line.back() == ' ' || command_line.back() == '\t';
+            return completion_words{Args::from_command_line_skip_program_name(std::string(command_line)), new_word};
+        }
+
+        template <typename Completions, Sink S>
+        void write_completions(Completions const & completions, completion_words const & request, S & sink)
+        {
+            if (request.writing_program_name())
+                return;
+
+            for (completion_candidate const & candidate : completions.complete(request.preceding(), request.current()))
+            {
+                write_completion(sink, candidate);
+                sink.write("\n");
+            }
+        }
+    }
+
+    // If the arguments are a completion request, as sent by the scripts of write_completion_script, writes the candidates for the last
+    // word of the command line that follows, one per line, and returns true. Otherwise returns false. Checking for the request before
+    // doing anything else makes completion as fast as the program can start, since the parser is not run. The completions may be a
+    // completion_index or a completion_file.
+    template <typename Completions, typename Destination>
+    bool answer_completion_request(Completions const & completions, ArgsView args, Destination && destination)
+    {
+        std::optional<detail::completion_words> const request = detail::split_completion_request(args);
+        if (!request)
+            return false;
+
+        auto && sink = sink_for(destination);
+        detail::write_completions(completions, *request, sink);
+        return true;
+    }
+
+    enum struct shell { bash, zsh, fish };
+
+    namespace detail
+    {
+        // In the scripts, {program} stands for the name of the program and {complete} for the command that answers completion requests.
+        constexpr std::string_view bash_completion_script =
+            "_{program}_complete()\n"
+            "{\n"
+            "    local IFS=$'\\n'\n"
+            "    COMPREPLY=($({complete} __complete \"${COMP_LINE:0:COMP_POINT}\" 2>/dev/null))\n"
+            "    # Bash splits words at equals signs, so values are completed without the option before them.\n"
+            "    if [[ $COMP_WORDBREAKS == *=* ]]; then\n"
+            "        COMPREPLY=(\"${COMPREPLY[@]#*=}\")\n"
+            "    fi\n"
+            "}\n"
+            "complete -o default -F _{program}_complete {program}\n";
+
+        constexpr std::string_view zsh_completion_script =
+            "#compdef {program}\n"
+            "_{program}_complete()\n"
+            "{\n"
+            "    local -a candidates\n"
+            "    candidates=(${(f)\"$({complete} __complete \"${BUFFER[1,CURSOR]}\" 2>/dev/null)\"})\n"
+            "    compadd -- $candidates\n"
+            "}\n"
+            "compdef _{program}_complete {program}\n";
+
+        constexpr std::string_view fish_completion_script =
+            "complete -c {program} -f -a '({complete} __complete (commandline -cp))'\n";
+    }
+
+    // Writes a script for the shell that completes the command line of the program by calling a command with completion_request and
+    // the command line up to the cursor. The command is the program itself unless another one is given, such as a helper that answers
+    // from a completion file. Requests are answered by answer_completion_request, which writes one candidate per line.
+    // The destination may be a string, an output stream or a sink.
+    template <typename Destination>
+    constexpr void write_completion_script(Destination && destination, shell target, std::string_view program, std::string_view complete_command = {})
+    {
+        auto && sink = sink_for(destination);
+
+        std::string_view script =
+            target == shell::bash ? detail::bash_completion_script :
+            target == shell::zsh ? detail::zsh_completion_script :
+            detail::fish_completion_script;
+
+        constexpr std::string_view program_placeholder = "{program}";
+        constexpr std::string_view complete_placeholder = "{complete}";
+
+        while (true)
+        {
+            size_t const program_at = script.find(program_placeholder);
+            size_t const complete_at = script.find(complete_placeholder);
+            size_t const placeholder_at = std::min(program_at, complete_at);
+            sink.write(script.substr(0, placeholder_at));
+            if (placeholder_at == std::string_view::npos)
+                return;
+
+            if (placeholder_at == program_at)
+            {
+                sink.write(program);
+                script.remove_prefix(placeholder_at + program_placeholder.size());
+            }
+            else
+            {
+                if (complete_command.empty())
+                {
+                    sink.write("\"");
+                    sink.write(program);
+                    sink.write("\"");
+                }
+                else
+                {
+                    sink.write(complete_command);
+                }
+                script.remove_prefix(placeholder_at + complete_placeholder.size());
+            }
+        }
+    }
+
+} // namespace dodo
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "completion.hh"
+#include "mapped_file.hh"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace dodo
+{
+
+    // A completion file holds a completion_index in a form that is used where it is loaded, with no parsing, so that a small helper can
+    // map it into memory and answer completion requests without starting the program it completes.
+    // All numbers are 32 bit little endian. The file is:
+    //   header:     "dodocmp1", node count, candidate count, size of the strings
+    //   nodes:      character (1 byte), is word end (1 byte), 2 bytes of padding, word value, first child, next sibling
+    //   candidates: kind (1 byte), 3 bytes of padding, text offset, text size, description offset, description size, next context
+    //   strings:    text and descriptions of the candidates, with no separators
+    namespace detail
+    {
+        constexpr std::string_view completion_file_magic = "dodocmp1";
+        constexpr size_t completion_file_header_size = 20;
+        constexpr size_t completion_file_node_size = 16;
+        constexpr size_t completion_file_candidate_size = 24;
+
+        template <Sink S>
+        constexpr void write_u32(S & sink, uint32_t value)
+        {
+            char const bytes[4] = {char(value & 0xFF), char((value >> 8) & 0xFF), char((value >> 16) & 0xFF), char((value >> 24) & 0xFF)};
+            sink.write(std::string_view(bytes, 4));
+        }
+
+        constexpr uint32_t read_u32(char const * bytes) noexcept
+        {
+            return uint32_t(uint8_t(bytes[0])) | (uint32_t(uint8_t(bytes[1])) << 8) | (uint32_t(uint8_t(bytes[2])) << 16) | (uint32_t(uint8_t(bytes[3])) << 24);
+        }
+    }
+
+    // Writes the index as a completion file. The destination may be a string, an output stream opened in binary mode or a sink.
+    template <size_t NodeCapacity, size_t CandidateCapacity, typename Destination>
+    constexpr void write_completion_file(completion_index<NodeCapacity, CandidateCapacity> const & index, Destination && destination)
+    {
+        auto && sink = sink_for(destination);
+
+        uint32_t strings_size = 0;
+        for (size_t i = 0; i < index.candidate_count; ++i)
+            strings_size += uint32_t(index.candidates[i].text.size() + index.candidates[i].description.size());
+
+        sink.write(detail::completion_file_magic);
+        detail::write_u32(sink, index.trie.node_count);
+        detail::write_u32(sink, uint32_t(index.candidate_count));
+        detail::write_u32(sink, strings_size);
+
+        for (uint32_t i = 0; i < index.trie.node_count; ++i)
+        {
+            auto const & node = index.trie.nodes[i];
+            char const flags[4] = {node.character, char(node.is_word_end ? 1 : 0), 0, 0};
+            sink.write(std::string_view(flags, 4));
+            detail::write_u32(sink, node.word_value);
+            detail::write_u32(sink, node.first_child);
+            detail::write_u32(sink, node.next_sibling);
+        }
+
+        uint32_t offset = 0;
+        for (size_t i = 0; i < index.candidate_count; ++i)
+        {
+            completion_candidate const & candidate = index.candidates[i];
+            char const kind[4] = {char(candidate.kind), 0, 0, 0};
+            sink.write(std::string_view(kind, 4));
+            detail::write_u32(sink, offset);
+            detail::write_u32(sink, uint32_t(candidate.text.size()));
+            detail::write_u32(sink, offset + uint32_t(candidate.text.size()));
+            detail::write_u32(sink, uint32_t(candidate.description.size()));
+            detail::write_u32(sink, index.next_contexts[i]);
+            offset += uint32_t(candidate.text.size() + candidate.description.size());
+        }
+
+        for (size_t i = 0; i < index.candidate_count; ++i)
+        {
+            sink.write(index.candidates[i].text);
+            sink.write(index.candidates[i].description);
+        }
+    }
+
+    // Completion index read from the bytes of a completion file, which it points into.
+    struct completion_file
+    {
+        // Returns nothing if the bytes are not a well formed completion file. Every index in the file is checked here, so that queries
+        // can trust them.
+        static std::optional<completion_file> from_bytes(std::span<char const> bytes) noexcept;
+
+        std::vector<completion_candidate> complete(std::span<std::string_view const> preceding_words, std::string_view word) const
+        {
+            return detail::complete(*this, preceding_words, word);
+        }
+
+        // Access to the trie for detail::complete.
+        uint32_t context_root(uint32_t context) const noexcept { return find_node(detail::completion_context_key(context).view(), 0); }
+        uint32_t find_node(std::string_view prefix, uint32_t root) const noexcept;
+        bool is_word_end(uint32_t node) const noexcept { return node_bytes(node)[1] != 0; }
+        uint32_t word_value(uint32_t node) const noexcept { return detail::read_u32(node_bytes(node) + 4); }
+        uint32_t first_child(uint32_t node) const noexcept { return detail::read_u32(node_bytes(node) + 8); }
+        uint32_t next_sibling(uint32_t node) const noexcept { return detail::read_u32(node_bytes(node) + 12); }
+        completion_candidate candidate(uint32_t index) const noexcept;
+        uint32_t next_context(uint32_t index) const noexcept { return detail::read_u32(candidate_bytes(index) + 20); }
+
+        uint32_t node_count = 0;
+        uint32_t candidate_count = 0;
+
+    private:
+        char const * node_bytes(uint32_t node) const noexcept { return nodes + size_t(node) * detail::completion_file_node_size; }
+        char const * candidate_bytes(uint32_t index) const noexcept { return candidates + size_t(index) * detail::completion_file_candidate_size; }
+
+        char const * nodes = nullptr;
+        char const * candidates = nullptr;
+        std::string_view strings;
+    };
+
+    inline std::optional<completion_file> completion_file::from_bytes(std::span<char const> bytes) noexcept
+    {
+        if (bytes.size() < detail::completion_file_header_size || std::string_view(bytes.data(), 8) != detail::completion_file_magic)
+            return std::nullopt;
+
+        completion_file file;
+        file.node_count = detail::read_u32(bytes.data() + 8);
+        file.candidate_count = detail::read_u32(bytes.data() + 12);
+        uint32_t const strings_size = detail::read_u32(bytes.data() + 16);
+
+        uint64_t const expected_size = detail::completion_file_header_size
+            + uint64_t(file.node_count) * detail::completion_file_node_size
+            + uint64_t(file.candidate_count) * detail::completion_file_candidate_size
+            + strings_size;
+        if (file.node_count == 0 || bytes.size() != expected_size)
+            return std::nullopt;
+
+        file.nodes = bytes.data() + detail::completion_file_header_size;
+        file.candidates = file.nodes + size_t(file.node_count) * detail::completion_file_node_size;
+        file.strings = std::string_view(file.candidates + size_t(file.candidate_count) * detail::completion_file_candidate_size, strings_size);
+
+        // Children come after their parents, and siblings before the ones that link to them, which rules out cycles.
+        for (uint32_t node = 0; node < file.node_count; ++node)
+        {
+            if (file.first_child(node) >= file.node_count || file.next_sibling(node) >= file.node_count)
+                return std::nullopt;
+            if (file.is_word_end(node) && file.word_value(node) >= file.candidate_count)
+                return std::nullopt;
+
+            for (uint32_t child = file.first_child(node); child != 0; child = file.next_sibling(child))
+                if (child <= node || (file.next_sibling(child) != 0 && file.next_sibling(child) >= child))
+                    return std::nullopt;
+        }
+
+        for (uint32_t index = 0; index < file.candidate_count; ++index)
+        {
+            char const * const candidate = file.candidate_bytes(index);
+            uint64_t const text_end = uint64_t(detail::read_u32(candidate + 4)) + detail::read_u32(candidate + 8);
+            uint64_t const description_end = uint64_t(detail::read_u32(candidate + 12)) + detail::read_u32(candidate + 16);
+            if (uint8_t(candidate[0]) > uint8_t(completion_kind::value) || text_end > strings_size || description_end > strings_size)
+                return std::nullopt;
+        }
+
+        return file;
+    }
+
+    inline uint32_t completion_file::find_node(std::string_view prefix, uint32_t root) const noexcept
+    {
+        uint32_t current = root;
+        for (char const c : prefix)
+        {
+            uint32_t child = first_child(current);
+            while (child != 0 && node_bytes(child)[0] != c)
+                child = next_sibling(child);
+
+            if (child == 0)
+                return 0;
+            current = child;
+        }
+        return current;
+    }
+
+    inline completion_candidate completion_file::candidate(uint32_t index) const noexcept
+    {
+        char const * const bytes = candidate_bytes(index);
+        completion_candidate result;
+        result.kind = completion_kind(bytes[0]);
+        result.text = strings.substr(detail::read_u32(bytes + 4), detail::read_u32(bytes + 8));
+        result.description = strings.substr(detail::read_u32(bytes + 12), detail::read_u32(bytes + 16));
+        return result;
+    }
+
+} // namespace dodo
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "completion.hh"
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace dodo
+{
+
+    // Listings of directories, which are kept until the modification time of the directory changes, as it does when entries are added,
+    // removed or renamed. Completing paths in a big directory then lists it once instead of on every key press.
+    struct directory_cache
+    {
+        // Names of the entries of the directory, with a slash after the names of directories. Empty if the directory can't be read.
+        std::vector<std::string> const & entries(std::filesystem::path const & directory)
+        {
+            std::error_code error;
+            std::filesystem::file_time_type const write_time = std::filesystem::last_write_time(directory, error);
+
+            listing & cached = listings[directory.string()];
+            if (!cached.listed || error || cached.write_time != write_time)
+            {
+                cached.entries = list(directory);
+                cached.write_time = write_time;
+                cached.listed = !error;
+                ++directory_listings;
+            }
+
+            return cached.entries;
+        }
+
+        void invalidate(std::filesystem::path const & directory) { listings.erase(directory.string()); }
+        void clear() noexcept { listings.clear(); }
+
+        // Number of times a directory has been read.
+        size_t listing_count() const noexcept { return directory_listings; }
+
+        static std::vector<std::string> list(std::filesystem::path const & directory)
+        {
+            std::vector<std::string> names;
+            std::error_code error;
+            for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+            {
+                std::string name = it->path().filename().string();
+                if (it->is_directory(error))
+                    name += '/';
+                names.push_back(std::move(name));
+            }
+            return names;
+        }
+
+    private:
+        struct listing
+        {
+            std::filesystem::file_time_type write_time;
+            std::vector<std::string> entries;
+            bool listed = false;
+        };
+
+        std::unordered_map<std::string, listing> listings;
+        size_t directory_listings = 0;
+    };
+
+    // Completes paths to files and directories, relative to the working directory or absolute. Hidden entries, whose names start with a
+    // dot, are only completed once a dot has been written. Directories are listed through the cache if there is one.
+    struct path_completion
+    {
+        void operator () (std::string_view value, std::vector<std::string> & candidates) const
+        {
+            size_t const separator = value.find_last_of("/\\");
+            std::string_view const directory = separator == std::string_view::npos ? std::string_view() : value.substr(0, separator + 1);
+            std::string_view const name = value.substr(directory.size());
+            std::filesystem::path const directory_path = directory.empty() ? std::filesystem::path(".") : std::filesystem::path(directory);
+
+            auto const add = [&](std::vector<std::string> const & entries)
+            {
+                for (std::string const & entry : entries)
+                {
+                    bool const is_directory = entry.ends_with('/');
+                    if (!entry.starts_with(name) || (entry.starts_with('.') && !name.starts_with('.')) || (directories_only && !is_directory))
+                        continue;
+
+                    std::string candidate(directory);
+                    candidate += entry;
+                    candidates.push_back(std::move(candidate));
+                }
+            };
+
+            if (cache)
+                add(cache->entries(directory_path));
+            else
+                add(directory_cache::list(directory_path));
+        }
+
+        directory_cache * cache = nullptr;
+        bool directories_only = false;
+    };
+
+    // Results of value providers that are slow to compute, such as the list of running jobs, kept by key for some time.
+    struct completion_cache
+    {
+        using clock = std::chrono::steady_clock;
+
+        // Values kept for the key if they are younger than max_age, or else the values compute appends to an empty vector.
+        template <typename F>
+        std::vector<std::string> const & values(std::string_view key, clock::duration max_age, F && compute)
+        {
+            clock::time_point const now = clock::now();
+            entry & cached = entries[std::string(key)];
+            if (!cached.computed || now - cached.time > max_age)
+            {
+                cached.values.clear();
+                compute(cached.values);
+                cached.time = now;
+                cached.computed = true;
+            }
+            return cached.values;
+        }
+
+        void invalidate(std::string_view key) { entries.erase(std::string(key)); }
+        void clear() noexcept { entries.clear(); }
+
+    private:
+        struct entry
+        {
+            clock::time_point time;
+            std::vector<std::string> values;
+            bool computed = false;
+        };
+
+        std::unordered_map<std::string, entry> entries;
+    };
+
+    // Value provider that asks the provider it wraps for all of its values, with an empty value, and keeps them in the cache under the key
+    // for max_age, so that writing more of the value filters them instead of computing them again.
+    template <DynamicCompletionProvider Provider>
+    struct cached_completion
+    {
+        void operator () (std::string_view, std::vector<std::string> & candidates) const
+        {
+            std::vector<std::string> const & all = cache->values(key, max_age, [this](std::vector<std::string> & out) { provider(std::string_view(), out); });
+            candidates.insert(candidates.end(), all.begin(), all.end());
+        }
+
+        Provider provider;
+        completion_cache * cache;
+        std::string_view key;
+        completion_cache::clock::duration max_age;
+    };
+
+    template <DynamicCompletionProvider Provider>
+    cached_completion(Provider, completion_cache *, std::string_view, completion_cache::clock::duration) -> cached_completion<Provider>;
+
+} // namespace dodo
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "expected.hh"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dodo
+{
+
+    // A key = value pair of a config file. The views point into the text of the file.
+    struct config_entry
+    {
+        std::string_view section;   // Name of the [section] the pair is in. Empty for pairs before the first section.
+        std::string_view key;
+        std::string_view value;
+        uint32_t line = 0;          // Line of the pair in the file, starting at 1.
+        std::string_view file;      // Name of the file the pair is in.
+    };
+
+    // Pairs of a config file in a subset of INI and TOML: "key = value" lines, "[section]" headers, and comments that start with '#' or ';'.
+    // Values may be quoted with double or single quotes, with no escape sequences, so that every value points into the text with no copies.
+    // The text, which may be the bytes of a mapped_file, must outlive the config_file.
+    struct config_file
+    {
+        // Errors are prefixed with the name of the file and the line they are in.
+        static expected<config_file, std::string> parse(std::string_view text, std::string_view name = "config");
+
+        // Pairs of several config files, such as a system config and a user config, given from lowest to highest precedence. Only the
+        // pair of the file with the highest precedence is kept for each key, so lookups don't depend on the number of files.
+        static config_file layered(std::span<config_file const * const> files, std::string_view name = "config");
+
+        // Last pair with the key in the section, since later pairs override earlier ones. Null if there is none.
+        config_entry const * find(std::string_view section, std::string_view key) const noexcept;
+
+        std::span<config_entry const> entries() const noexcept { return sorted_entries; }
+
+        std::string_view name;
+
+    private:
+        std::vector<config_entry> sorted_entries;   // By section and key, and by line for pairs with the same key.
+    };
+
+    namespace detail
+    {
+        constexpr std::string_view trim_config_blanks(std::string_view text) noexcept
+        {
+            size_t const first = text.find_first_not_of(" \t\r");
+            if (first == std::string_view::npos)
+                return {};
+            return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+        }
+
+        constexpr bool is_config_comment_or_blank(std::string_view text) noexcept
+        {
+            text = trim_config_blanks(text);
+            return text.empty() || text[0] == '#' || text[0] == ';';
+        }
+
+        constexpr bool is_config_key(std::string_view key) noexcept
+        {
+            return !key.empty() && std::all_of(key.begin(), key.end(), [](char c)
+            {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+            });
+        }
+
+        constexpr bool config_entry_less(config_entry const & a, config_entry const & b) noexcept
+        {
+            if (a.section != b.section)
+                return a.section < b.section;
+            return a.key < b.key;
+        }
+
+        inline Error<std::string> config_error(std::string_view name, uint32_t line, std::string_view message)
+        {
+            std::string error(name);
+            error += ':';
+            error += std::to_string(line);
+            error += ": ";
+            error += message;
+            return error;
+        }
+    }
+
+    inline expected<config_file, std::string> config_file::parse(std::string_view text, std::string_view name)
+    {
+        config_file file;
+        file.name = name;
+
+        std::string_view section;
+        uint32_t line_number = 0;
+        while (!text.empty())
+        {
+            ++line_number;
+            size_t const line_end = text.find('\n');
+            std::string_view const line = detail::trim_config_blanks(text.substr(0, line_end));
+            text.remove_prefix(line_end == std::string_view::npos ? text.size() : line_end + 1);
+
+            if (detail::is_config_comment_or_blank(line))
+                continue;
+
+            if (line[0] == '[')
+            {
+                size_t const closing = line.find(']');
+                if (closing == std::string_view::npos)
+                    return detail::config_error(name, line_number, "Expected ']' at the end of the section header");
+                if (!detail::is_config_comment_or_blank(line.substr(closing + 1)))
+                    return detail::config_error(name, line_number, "Unexpected text after the section header");
+
+                section = detail::trim_config_blanks(line.substr(1, closing - 1));
+                if (!detail::is_config_key(section))
+                    return detail::config_error(name, line_number, "Invalid section name");
+                continue;
+            }
+
+            size_t const equals = line.find('=');
+            if (equals == std::string_view::npos)
+                return detail::config_error(name, line_number, "Expected key = value");
+
+            std::string_view const key = detail::trim_config_blanks(line.substr(0, equals));
+            if (!detail::is_config_key(key))
+                return detail::config_error(name, line_number, "Invalid key");
+
+            std::string_view value = detail::trim_config_blanks(line.substr(equals + 1));
+            if (!value.empty() && (value[0] == '"' || value[0] == '\''))
+            {
+                size_t const closing = value.find(value[0], 1);
+                if (closing == std::string_view::npos)
+                    return detail::config_error(name, line_number, "Unterminated string");
+                if (!detail::is_config_comment_or_blank(value.substr(closing + 1)))
+                    return detail::config_error(name, line_number, "Unexpected text after the string");
+                value = value.substr(1, closing - 1);
+            }
+            else
+            {
+                // In unquoted values, comments start with a '#' after a blank.
+                for (size_t i = 1; i < value.size(); ++i)
+                {
+                    if (value[i] == '#' && (value[i - 1] == ' ' || value[i - 1] == '\t'))
+                    {
+                        value = detail::trim_config_blanks(value.substr(0, i));
+                        break;
+                    }
+                }
+            }
+
+            file.sorted_entries.push_back(config_entry{section, key, value, line_number, name});
+        }
+
+        std::stable_sort(file.sorted_entries.begin(), file.sorted_entries.end(), detail::config_entry_less);
+        return file;
+    }
+
+    inline config_file config_file::layered(std::span<config_file const * const> files, std::string_view name)
+    {
+        config_file layers;
+        layers.name = name;
+        for (config_file const * const file : files)
+            layers.sorted_entries.insert(layers.sorted_entries.end(), file->sorted_entries.begin(), file->sorted_entries.end());
+
+        // The sort is stable, so the last pair of each key is the one of the file with the highest precedence.
+        std::stable_sort(layers.sorted_entries.begin(), layers.sorted_entries.end(), detail::config_entry_less);
+        auto const last_of_each_key = std::unique(layers.sorted_entries.rbegin(), layers.sorted_entries.rend(), [](config_entry const & a, config_entry const & b)
+        {
+            return a.section == b.section && a.key == b.key;
+        });
+        layers.sorted_entries.erase(layers.sorted_entries.begin(), last_of_each_key.base());
+        return layers;
+    }
+
+    inline config_entry const * config_file::find(std::string_view section, std::string_view key) const noexcept
+    {
+        auto const range = std::equal_range(sorted_entries.begin(), sorted_entries.end(), config_entry{section, key, {}, 0, {}}, detail::config_entry_less);
+        if (range.first == range.second)
+            return nullptr;
+        return &*(range.second - 1);
+    }
+
+} // namespace dodo
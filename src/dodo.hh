@@ -1,10 +1,26 @@
 #pragma once
 
 #include "parse_traits.hh"
+#include "args.hh"
 #include "expected.hh"
+#include "compact_variant.hh"
+#include "completion.hh"
+#include "config_file.hh"
+#include "environment.hh"
+#include "help_index.hh"
+#include "lazy.hh"
+#include "perfect_hash.hh"
+#include "prefix_trie.hh"
+#include "schema.hh"
+#include "sink.hh"
+#include "terminal.hh"
+#include "suggestions.hh"
 #include <concepts>
 #include <span>
+#include <stdexcept>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace dodo
 {
@@ -45,28 +61,60 @@ namespace dodo
         using Ts::operator()...;
     };
 
-    struct Args : public std::vector<std::string_view>
+    enum struct value_origin_kind : uint8_t { command_line, profile, environment, config_file, default_value };
+
+    // Where the value of an option came from.
+    struct value_origin
     {
-        explicit Args(std::vector<std::string_view> args) noexcept : std::vector<std::string_view>(args) {}
+        std::string section;        // Path of the command the option belongs to, such as "remote.add". Empty if it belongs to no command.
+        std::string_view option;    // First pattern of the option.
+        value_origin_kind kind = value_origin_kind::command_line;
+        std::string_view source;    // Name of the profile, of the environment variable or of the config file.
+        uint32_t line = 0;          // Line in the config file.
+    };
 
-        // Same as Args::from_argc_argv_skip_program_name(argc, argv)
-        explicit Args(int argc, char const * const argv[]) noexcept : std::vector<std::string_view>(argv + 1, argv + argc) {}
+    // Value of an option in a profile. The key is a pattern of the option without the leading dashes, as in config files.
+    struct profile_value
+    {
+        std::string_view key;
+        std::string_view value;
+    };
 
-        static Args from_argc_argv(int argc, char const * const argv[]) noexcept { return Args(std::vector<std::string_view>(argv, argv + argc)); }
-        static Args from_argc_argv_skip_program_name(int argc, char const * const argv[]) noexcept { return Args(argc, argv); }
+    // Where options that are not in the command line take their values from before their default values, in order of precedence.
+    // Each option is resolved with a single lookup per source, from the highest precedence down, and only the value that wins is converted.
+    struct value_sources
+    {
+        constexpr value_sources() noexcept = default;
+        constexpr value_sources(environment_lookup environment_) noexcept : environment(environment_) {}
+        constexpr value_sources(config_file const & config_) noexcept : config(&config_) {}
+        constexpr value_sources(environment_lookup environment_, config_file const & config_) noexcept : environment(environment_), config(&config_) {}
 
-        static Args from_command_line(std::string command_line);
-        static Args from_command_line_skip_program_name(std::string command_line);
+        // Values of the profile that was chosen in the command line, sorted by key.
+        std::span<profile_value const> profile;
+        std::string_view profile_name;
 
-    private:
-        std::string buffer;
-        Args() noexcept = default;
+        environment_lookup environment;
+
+        // Options are looked up in the config file by their patterns without the leading dashes. Options of a command are looked up in
+        // the section named after the path of commands to it joined with dots, such as [remote.add], and the rest before the first section.
+        config_file const * config = nullptr;
+        std::string_view section;
+
+        // If not null, where the value of each option came from is appended to it.
+        std::vector<value_origin> * origins = nullptr;
     };
 
-    struct ArgsView : public std::span<std::string_view const>
+    // Columns and width of help text. The defaults are the fixed columns that to_string uses.
+    // measure_help_layout computes the columns that fit the patterns, hints and names of a parser.
+    struct help_layout
     {
-        ArgsView(Args const & args) noexcept : std::span<std::string_view const>(args.begin(), args.end()) {}
-        constexpr ArgsView(std::span<std::string_view const> args) noexcept : std::span<std::string_view const>(args) {}
+        size_t option_column = 40;  // Column where the descriptions of options and positional arguments start.
+        size_t command_column = 25; // Column where the descriptions of commands start.
+        size_t width = 0;           // Width descriptions are wrapped to. 0 means that they are not wrapped.
+        bool values = true;         // Whether default and implicit values are written.
+
+        // Same columns, made to fit in the given width.
+        constexpr help_layout wrapped_to(size_t width) const noexcept;
     };
 
     template <typename T>
@@ -94,6 +142,15 @@ namespace dodo
                 return error_message;
         }
 
+        template <typename F>
+        constexpr void for_each_check_message(F && f) const
+        {
+            if constexpr (requires { Base::for_each_check_message(f); })
+                Base::for_each_check_message(f);
+
+            f(error_message);
+        }
+
     private:
         Predicate validation_predicate;
         std::string_view error_message;
@@ -125,6 +182,29 @@ namespace dodo
         {option.default_value} -> explicitly_convertible_to<typename T::value_type>;
     };
 
+    // Default value that is computed by a function when the option is not given. A function with no parameters is called while parsing,
+    // or the first time the value is read if the value_type is a dodo::lazy. A function that takes the result of the options the option
+    // is in derives its value from the other options, once they have all been parsed. Derived values that are not dodo::lazy are computed
+    // first, in the order of the options, so they may only read derived options declared before their own; those declared after them hold
+    // a default initialized value. Derived values that are dodo::lazy are computed when first read, from one copy of the result of the
+    // options shared by all of them, so they may read every option except the other lazy derived ones. Reading a lazy derived option from
+    // a function that derives a value throws derivation_order_error, which makes the parse fail if it happens while parsing.
+    struct derivation_order_error : std::logic_error
+    {
+        using std::logic_error::logic_error;
+    };
+
+    template <typename Base, typename F>
+    struct WithLazyDefaultValue : public Base
+    {
+        constexpr explicit WithLazyDefaultValue(Base base, F compute_default_value_) noexcept : Base(base), compute_default_value(std::move(compute_default_value_)) {}
+
+        F compute_default_value;
+    };
+
+    template <typename T>
+    concept HasLazyDefaultValue = requires(T option) { option.compute_default_value; };
+
     template <typename Base>
     struct WithDescription : public Base
     {
@@ -178,6 +258,27 @@ namespace dodo
             return out;
         }
 
+        template <Sink S>
+        constexpr void write_patterns(S & sink) const
+        {
+            if constexpr (Pattern<Base>)
+            {
+                Base::write_patterns(sink);
+                sink.write(", ");
+            }
+
+            sink.write(pattern);
+        }
+
+        template <typename F>
+        constexpr void for_each_pattern(F && f) const
+        {
+            if constexpr (Pattern<Base>)
+                Base::for_each_pattern(f);
+
+            f(pattern);
+        }
+
     private:
         std::string_view pattern;
     };
@@ -214,6 +315,77 @@ namespace dodo
         std::string_view custom_hint;
     };
 
+    template <typename Base>
+    struct WithEnvironmentVariable : public Base
+    {
+        constexpr explicit WithEnvironmentVariable(Base base, std::string_view name) noexcept : Base(base), environment_variable(name) {}
+
+        std::string_view environment_variable;
+    };
+
+    template <typename T>
+    concept HasEnvironmentVariable = requires(T option) { {option.environment_variable} -> std::convertible_to<std::string_view>; };
+
+    // Named bundle of option values, such as the values of a "prod" or a "debug" preset, that is chosen with an option made with
+    // OptionInterface::profiles. Values are text, as in the command line, and are sorted by key so that each option takes a binary search.
+    template <size_t N>
+    struct profile
+    {
+        constexpr profile(std::string_view name_, profile_value const (&values_)[N]) noexcept : name(name_)
+        {
+            std::copy(values_, values_ + N, values);
+            std::sort(values, values + N, [](profile_value const & a, profile_value const & b) { return a.key < b.key; });
+        }
+
+        std::string_view name;
+        profile_value values[N];
+    };
+
+    template <typename Base, size_t ProfileCount, size_t ValueCount>
+    struct WithProfiles : public Base
+    {
+        struct profile_range
+        {
+            std::string_view name;
+            size_t first = 0;
+            size_t count = 0;
+        };
+
+        template <size_t ... N>
+        constexpr explicit WithProfiles(Base base, profile<N> const & ... profiles_) noexcept : Base(base)
+        {
+            size_t count = 0;
+            size_t first = 0;
+            ((profile_ranges[count++] = profile_range{profiles_.name, first, N}, std::copy(profiles_.values, profiles_.values + N, profile_values + first), first += N), ...);
+        }
+
+        // Values of the profile with the given name, or nothing if there is no such profile.
+        constexpr std::optional<std::span<profile_value const>> find_profile(std::string_view name) const noexcept
+        {
+            for (profile_range const & p : profile_ranges)
+                if (p.name == name)
+                    return std::span<profile_value const>(profile_values + p.first, p.count);
+            return std::nullopt;
+        }
+
+        profile_range profile_ranges[ProfileCount];
+        profile_value profile_values[ValueCount > 0 ? ValueCount : 1] = {};
+    };
+
+    template <typename T>
+    concept HasProfiles = requires(T option, std::string_view name) { {option.find_profile(name)} -> std::same_as<std::optional<std::span<profile_value const>>>; };
+
+    template <typename Base, CompletionProvider Provider>
+    struct WithCompletionProvider : public Base
+    {
+        constexpr explicit WithCompletionProvider(Base base, Provider provider) noexcept : Base(base), completion_provider(provider) {}
+
+        Provider completion_provider;
+    };
+
+    template <typename T>
+    concept HasCompletionProvider = requires(T option) { {option.completion_provider} -> CompletionProvider; };
+
     template <typename T>
     concept OptionStruct = requires(T a) { { a._get() } -> std::same_as<typename T::value_type const &>; };
 
@@ -267,8 +439,9 @@ namespace dodo
         explicit constexpr OptionInterface(Base base) noexcept : Base(base) {}
 
         auto parse(std::string_view matched_arg) const noexcept -> expected<typename Base::parse_result_type, std::string>;
-        auto parse(ArgsView args) const noexcept -> expected<typename Base::parse_result_type, std::string>;
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<typename Base::parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const requires HasDescription<Base>;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const requires HasDescription<Base>;
 
         constexpr OptionInterface<WithDescription<Base>> operator () (std::string_view description) const noexcept requires(!HasDescription<Base>)
         {
@@ -281,11 +454,17 @@ namespace dodo
         }
 
         template <explicitly_convertible_to<typename Base::value_type> T>
-        constexpr OptionInterface<WithDefaultValue<Base, T>> by_default(T default_value) const noexcept requires(!HasDefaultValue<Base>)
+        constexpr OptionInterface<WithDefaultValue<Base, T>> by_default(T default_value) const noexcept requires(!HasDefaultValue<Base> && !HasLazyDefaultValue<Base>)
         {
             return OptionInterface<WithDefaultValue<Base, T>>(WithDefaultValue<Base, T>(*this, std::move(default_value)));
         }
 
+        template <typename F>
+        constexpr OptionInterface<WithLazyDefaultValue<Base, F>> by_default_lazy(F compute_default_value) const noexcept requires(!HasDefaultValue<Base> && !HasLazyDefaultValue<Base>)
+        {
+            return OptionInterface<WithLazyDefaultValue<Base, F>>(WithLazyDefaultValue<Base, F>(*this, std::move(compute_default_value)));
+        }
+
         template <typename ... Ts>
         constexpr auto by_default_range(Ts ... default_values) const noexcept -> decltype(by_default(constant_range{default_values...}))
         {
@@ -320,6 +499,30 @@ namespace dodo
         {
             return OptionInterface<WithCustomHint<Base>>(WithCustomHint<Base>(*this, custom_hint));
         }
+
+        // Values that shell completion offers for the option, instead of those of its type.
+        template <CompletionProvider Provider>
+        constexpr OptionInterface<WithCompletionProvider<Base, Provider>> complete_with(Provider provider) const noexcept requires(!HasCompletionProvider<Base>)
+        {
+            return OptionInterface<WithCompletionProvider<Base, Provider>>(WithCompletionProvider<Base, Provider>(*this, provider));
+        }
+
+        // Environment variable the option takes its value from if it is not in the command line. The command line takes precedence
+        // over the environment, and the environment over the default value.
+        constexpr OptionInterface<WithEnvironmentVariable<Base>> env(std::string_view name) const noexcept requires(!HasEnvironmentVariable<Base>)
+        {
+            return OptionInterface<WithEnvironmentVariable<Base>>(WithEnvironmentVariable<Base>(*this, name));
+        }
+
+        // Makes the option choose one of the profiles by name. The values of the chosen profile are used for the options that are not
+        // in the command line, with precedence over the other sources. Only the options of the same parser of options take them.
+        // Profiles are applied after the command line is matched, in the same pass, so the command line is never rewritten.
+        template <size_t ... N>
+        constexpr auto profiles(profile<N> const & ... profiles_) const noexcept
+            -> OptionInterface<WithProfiles<Base, sizeof...(N), (N + ... + 0)>> requires(!HasProfiles<Base> && std::constructible_from<std::string_view, typename Base::value_type>)
+        {
+            return OptionInterface<WithProfiles<Base, sizeof...(N), (N + ... + 0)>>(WithProfiles<Base, sizeof...(N), (N + ... + 0)>(*this, profiles_...));
+        }
     };
 
     template <OptionStruct T>
@@ -353,6 +556,7 @@ namespace dodo
         auto parse(std::string_view matched_arg) const noexcept -> expected<typename Base::parse_result_type, std::string>;
         auto parse(ArgsView args) const noexcept -> expected<typename Base::parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const requires HasDescription<Base>;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const requires HasDescription<Base>;
 
         constexpr PositionalArgumentInterface<WithDescription<Base>> operator () (std::string_view description) const noexcept requires(!HasDescription<Base>)
         {
@@ -408,14 +612,29 @@ namespace dodo
 
         struct parse_result_type : public detail::get_parse_result_type<Options>... {};
 
-        auto parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>;
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
+
+        static constexpr size_t option_count = sizeof...(Options);
 
         template <SingleOption T>
         constexpr T const & access_option() const noexcept
         {
             return static_cast<T const &>(*this);
         }
+
+        template <size_t I>
+        constexpr auto const & access_option() const noexcept
+        {
+            return access_option<std::tuple_element_t<I, std::tuple<Options...>>>();
+        }
+
+        template <typename F>
+        constexpr void for_each_option(F && f) const
+        {
+            (f(access_option<Options>()), ...);
+        }
     };
 
     template <SingleOption A, SingleOption B>         constexpr CompoundOption<A, B> operator | (A a, B b) noexcept;
@@ -432,12 +651,19 @@ namespace dodo
 
         auto parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
 
         template <SingleArgument T>
         constexpr T const & access_argument() const noexcept
         {
             return static_cast<T const &>(*this);
         }
+
+        template <typename F>
+        constexpr void for_each_argument(F && f) const
+        {
+            (f(access_argument<Arguments>()), ...);
+        }
     };
 
     template <SingleArgument A, SingleArgument B>         constexpr CompoundArgument<A, B> operator | (A a, B b) noexcept;
@@ -452,8 +678,9 @@ namespace dodo
 
         struct parse_result_type : public detail::get_parse_result_type<Arguments>, public detail::get_parse_result_type<Options> {};
 
-        auto parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>;
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
 
         constexpr Options const & access_options() const noexcept
         {
@@ -513,6 +740,9 @@ namespace dodo
         {parser.parse(args)} -> std::same_as<expected<typename T::parse_result_type, std::string>>; 
     };
 
+    template <typename C, typename KeyFunction>
+    struct CoalescingCommand;
+
     template <Parser P>
     struct Command
     {
@@ -525,8 +755,16 @@ namespace dodo
         {}
 
         constexpr bool match(std::string_view text) const noexcept { return text == name; }
-        constexpr auto parse_command(ArgsView args) const noexcept;
+        constexpr auto parse_command(ArgsView args, value_sources const & sources = {}) const noexcept;
         std::string to_string(int indentation) const noexcept;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
+
+        // Name and description of the command followed by the help of its parser.
+        template <Sink S> constexpr void write_detailed_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
+
+        // Makes the command coalescing, with the key returned by key_function for its parsed arguments.
+        template <typename KeyFunction>
+        constexpr CoalescingCommand<Command, KeyFunction> coalesce_by(KeyFunction key_function) const noexcept;
 
         std::string_view name;
         std::string_view description;
@@ -541,24 +779,81 @@ namespace dodo
         {t.to_string(indentation)} -> std::same_as<std::string>;
     };
 
+    template <typename T>
+    concept NamedCommand = CommandType<T> && requires(T t) { {t.name} -> std::convertible_to<std::string_view>; };
+
+    // Command whose parsed arguments give a key, such that when a batch of commands is dispatched only the last command with each key
+    // is run. For example, of "set fov 90; set fov 100" only "set fov 100" is run if the key of set is the name of the variable.
+    template <typename C, typename KeyFunction>
+    struct CoalescingCommand : public C
+    {
+        constexpr explicit CoalescingCommand(C command, KeyFunction key_function_) noexcept : C(command), key_function(key_function_) {}
+
+        std::string coalescing_key(typename C::parse_result_type const & parse_result) const { return std::string(key_function(parse_result)); }
+
+        KeyFunction key_function;
+    };
+
+    template <typename T>
+    concept Coalescing = CommandType<T> && requires(T t, typename T::parse_result_type const & parse_result) {
+        {t.coalescing_key(parse_result)} -> std::same_as<std::string>;
+    };
+
     template <CommandType ... Commands>
     struct CommandSelector : private Commands...
     {
         using parse_result_type = std::variant<detail::get_parse_result_type<Commands>...>;
+        using compact_parse_result_type = compact_variant<detail::get_parse_result_type<Commands>...>;
+
+        static constexpr size_t command_count = sizeof...(Commands);
+        static constexpr size_t named_command_count = (size_t(NamedCommand<Commands>) + ... + 0);
 
         constexpr explicit CommandSelector(Commands... commands) noexcept : Commands(commands)... {}
 
-        auto parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>;
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
+
+        // Parses the arguments with the I-th command without checking if it matches args[0].
+        template <size_t I>
+        auto parse_with_command(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
+
+        // Same as parse, but the result only takes the memory of the command that was parsed. Results that do not fit in
+        // the inline buffer of compact_variant are allocated from the given memory resource.
+        auto parse_compact(ArgsView args, std::pmr::memory_resource * resource = std::pmr::get_default_resource(), value_sources const & sources = {}) const noexcept
+            -> expected<compact_parse_result_type, std::string>;
+
+        // Parses each command of the batch and calls handler with the results in order. Commands that are superseded by a later coalescing
+        // command with the same key are dropped before any handler is run, so the handlers run once per key rather than once per command.
+        // Returns the number of handlers run.
+        template <std::invocable<expected<parse_result_type, std::string>> Handler>
+        size_t dispatch_batch(std::span<Args const> batch, Handler && handler) const;
 
         constexpr bool match(std::string_view text) const noexcept { return (access_command<Commands>().match(text) || ...); }
 
         std::string to_string(int indentation = 0) const noexcept;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
+
+        // Writes the detailed help of the command that matches the given name, and nothing else. Returns false if no command matches.
+        template <Sink S>
+        constexpr bool write_help_for(std::string_view command_name, S & sink, int indentation = 0, help_layout const & layout = {}) const;
+        std::optional<std::string> help_for(std::string_view command_name) const;
 
         template <CommandType C>
         constexpr C const & access_command() const noexcept
         {
             return static_cast<C const &>(*this);
         }
+
+        template <size_t I>
+        constexpr auto const & access_command() const noexcept
+        {
+            return access_command<std::tuple_element_t<I, std::tuple<Commands...>>>();
+        }
+
+        template <typename F>
+        constexpr void for_each_command(F && f) const
+        {
+            (f(access_command<Commands>()), ...);
+        }
     };
 
     template <CommandType A, CommandType B>     constexpr CommandSelector<A, B> operator | (A a, B b) noexcept;
@@ -580,8 +875,9 @@ namespace dodo
             typename Commands::parse_result_type command;
         };
 
-        auto parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>;
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const noexcept;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
 
         SharedOptions shared_options;
         Commands commands;
@@ -611,8 +907,9 @@ namespace dodo
 
         using parse_result_type = either<typename Commands::parse_result_type, typename ImplicitCommand::parse_result_type>;
 
-        auto parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>;
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
         std::string to_string(int indentation = 0) const noexcept;
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const;
 
         Commands commands;
         ImplicitCommand implicit_command;
@@ -628,6 +925,233 @@ namespace dodo
     constexpr auto operator | (CommandWithImplicitCommand<Commands, CurrentImplicitCommand> commands, NewImplicitCommand new_implicit_command) noexcept
         -> CommandWithImplicitCommand<Commands, decltype(commands.implicit_command | new_implicit_command)>;
 
+    // Parsers whose names can be enumerated. The names of a command selector are those of its commands, and the names of a parser of
+    // options are the patterns of its options.
+    template <typename T>
+    concept ParserWithNames = instantiation_of<T, CommandSelector> || instantiation_of<T, CompoundOption> || instantiation_of<T, CompoundParser>;
+
+    template <ParserWithNames P>
+    constexpr size_t name_count(P parser) noexcept;
+
+    // Index of the names of the parser for finding suggestions for misspelled ones. For consoles that want to offer suggestions for
+    // big command sets. dodo_SuggestionIndex(cli) builds one for a constexpr parser at compile time.
+    template <size_t Capacity, ParserWithNames P>
+    constexpr suggestion_index<Capacity> make_suggestion_index(P parser) noexcept;
+
+    #define dodo_SuggestionIndex(cli) dodo::make_suggestion_index<dodo::name_count(cli)>(cli)
+
+    // Number of trie nodes needed to abbreviate the command names or option patterns of the parser.
+    template <ParserWithNames P>
+    constexpr size_t abbreviation_trie_capacity(P parser) noexcept;
+
+    // Parser that accepts unique prefixes of command names and option patterns. For example "st" for "status" or "--verb=true" for
+    // "--verbose=true", as long as no other command or option starts the same way. Exact names take precedence over abbreviations.
+    // Resolution walks a trie that is built at compile time for constexpr parsers, so it takes time proportional to the length of the text.
+    // dodo_Abbreviated(cli) builds one with a trie of the size the parser needs.
+    template <ParserWithNames P, size_t TrieCapacity>
+    struct Abbreviated : public P
+    {
+        using parse_result_type = typename P::parse_result_type;
+        using base_parser_type = P;
+
+        constexpr explicit Abbreviated(P parser) noexcept;
+
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
+
+        prefix_trie<TrieCapacity> trie;
+    };
+
+    #define dodo_Abbreviated(cli) dodo::Abbreviated<std::remove_cvref_t<decltype(cli)>, dodo::abbreviation_trie_capacity(cli)>(cli)
+
+    // Name of the file in a path, without directories or the ".exe" extension. Does not allocate.
+    constexpr std::string_view program_basename(std::string_view path) noexcept;
+
+    // Front end for a single binary that is installed under the name of each of its tools, busybox style. The tool is chosen by the
+    // name the program was called with, so "/usr/bin/cat a.txt" parses "a.txt" with the command named "cat". When the program is called
+    // by its own name the tool is chosen by the first argument instead, as in "toolbox cat a.txt".
+    // Tool names are looked up in a perfect hash that is built at compile time for constexpr parsers.
+    template <instantiation_of<CommandSelector> Commands>
+    struct Multicall
+    {
+        using parse_result_type = typename Commands::parse_result_type;
+
+        constexpr explicit Multicall(std::string_view program_name_, Commands commands_) noexcept;
+
+        // args[0] must be the path the program was called with, as given by Args::from_argc_argv.
+        auto parse(ArgsView args, value_sources const & sources = {}) const noexcept -> expected<parse_result_type, std::string>;
+        std::string to_string(int indentation = 0) const noexcept { return commands.to_string(indentation); }
+        template <Sink S> constexpr void write_help(S & sink, int indentation = 0, help_layout const & layout = {}) const { commands.write_help(sink, indentation, layout); }
+
+        std::string_view program_name;
+        Commands commands;
+        perfect_hash<Commands::named_command_count> tools;
+    };
+
+    // Help that was asked for in the command line. command is the name of the command whose help was asked for, or empty if the help
+    // of the whole program was asked for.
+    struct help_request
+    {
+        std::string_view command;
+    };
+
+    constexpr std::string_view default_help_tokens[] = {"--help", "-h", "help"};
+
+    // Looks for a help token anywhere in the arguments, without parsing them, so that help can be shown even if the rest of the
+    // command line has errors. If the parser has commands, the first argument that names one is the command whose help was asked for.
+    // The arguments are only compared with the help tokens unless one is found, and no value is converted.
+    template <typename P>
+    constexpr std::optional<help_request> find_help_request(P const & parser, ArgsView args,
+        std::span<std::string_view const> help_tokens = default_help_tokens) noexcept;
+
+    // Same as above, but finds the command with one probe per argument in the names of the commands that dodo_CommandNames(cli) hashes
+    // at compile time, instead of comparing each argument with every command.
+    template <typename P, size_t Capacity>
+    constexpr std::optional<help_request> find_help_request(P const & parser, perfect_hash<Capacity> const & command_names, ArgsView args,
+        std::span<std::string_view const> help_tokens = default_help_tokens) noexcept;
+
+    // Perfect hash of the names of the commands of a parser, from each name to the index of its command.
+    template <typename P>
+    constexpr auto make_command_names(P const & parser) noexcept;
+
+    #define dodo_CommandNames(cli) dodo::make_command_names(cli)
+
+    // Streams the help text of a parser to a sink, a string or an output stream, fragment by fragment, with no intermediate strings.
+    // Takes time proportional to the length of the text.
+    template <typename P, typename Destination>
+    constexpr void write_help(P const & parser, Destination && destination, int indentation = 0, help_layout const & layout = {});
+
+    // Help with only the names and descriptions of the commands of a parser, or of its options and arguments if it has no commands.
+    template <typename P, typename Destination>
+    constexpr void write_help_summary(P const & parser, Destination && destination, int indentation = 0, help_layout const & layout = {});
+
+    // Detailed help of the command of the parser with the given name, or nothing if the parser has no such command.
+    template <typename P>
+    std::optional<std::string> help_for(P const & parser, std::string_view command_name);
+
+    // Number of entries and words in the help of a parser, which is the size of the index dodo_HelpIndex builds for it.
+    template <typename P>
+    constexpr help_index_size measure_help_index(P const & parser) noexcept;
+
+    // Index of the words in the names and descriptions of the commands, options and arguments of a parser, for searching its help by
+    // keywords, as in "help search <term>". dodo_HelpIndex(cli) builds one at compile time.
+    template <size_t EntryCapacity, size_t PostingCapacity, typename P>
+    constexpr help_index<EntryCapacity, PostingCapacity> make_help_index(P const & parser) noexcept;
+
+    #define dodo_HelpIndex(cli) dodo::make_help_index<dodo::measure_help_index(cli).entries, dodo::measure_help_index(cli).postings>(cli)
+
+    // Number of options of a parser that read an environment variable.
+    template <typename P>
+    constexpr size_t environment_variable_count(P const & parser) noexcept;
+
+    // Index of the environment variables that the options of a parser read, for finding all of their values with a single scan of the
+    // environment before parsing. dodo_EnvironmentIndex(cli) builds one at compile time.
+    template <size_t Capacity, typename P>
+    constexpr environment_index<Capacity> make_environment_index(P const & parser) noexcept;
+
+    #define dodo_EnvironmentIndex(cli) dodo::make_environment_index<dodo::environment_variable_count(cli)>(cli)
+
+    // Checks the profiles of a parser: that profile names are unique, that each value sets an option of the parser once, and that the
+    // values of numbers, booleans and types whose parse traits are constexpr convert to the type of the option. Returns the first error,
+    // or an empty string if there is none, so that static_assert(dodo::profile_error(cli).empty()) checks them at compile time.
+    template <typename P>
+    constexpr std::string_view profile_error(P const & parser) noexcept;
+
+    // Number of trie nodes and candidates needed to complete the command lines of a parser.
+    template <typename P>
+    constexpr completion_index_size measure_completion_index(P const & parser) noexcept;
+
+    // Index of the commands, option patterns and option values of a parser, for completing its command lines from a shell. Values are
+    // those given to complete_with or else those of the types that are TraitWithValues. dodo_CompletionIndex(cli) builds one at compile time.
+    template <size_t NodeCapacity, size_t CandidateCapacity, typename P>
+    constexpr completion_index<NodeCapacity, CandidateCapacity> make_completion_index(P const & parser) noexcept;
+
+    #define dodo_CompletionIndex(cli) dodo::make_completion_index<dodo::measure_completion_index(cli).nodes, dodo::measure_completion_index(cli).candidates>(cli)
+
+    // Same as answer_completion_request in completion.hh, but values of options with a DynamicCompletionProvider are completed too, by calling the provider in the parser.
+    template <typename P, size_t NodeCapacity, size_t CandidateCapacity, typename Destination>
+    bool answer_completion_request(P const & parser, completion_index<NodeCapacity, CandidateCapacity> const & completions, ArgsView args, Destination && destination);
+
+    // Columns that fit the patterns, hints and command names of a parser, which can be computed at compile time.
+    template <typename P>
+    constexpr help_layout measure_help_layout(P const & parser, int indentation = 0);
+
+    // Help text of a parser laid out to the width of the terminal, with the columns measured once. The text laid out for each width is
+    // kept, so repeated help requests only cost a lookup. Not thread safe.
+    template <typename P>
+    struct help_cache
+    {
+        constexpr explicit help_cache(P parser_) : help_cache(parser_, measure_help_layout(parser_)) {}
+        constexpr explicit help_cache(P parser_, help_layout columns_) : parser(parser_), columns(columns_) {}
+
+        // Help text laid out to the given width. 0 means that descriptions are not wrapped.
+        std::string_view text(size_t width);
+        std::string_view text() { return text(terminal_width()); }
+
+        P parser;
+        help_layout columns;
+
+    private:
+        std::unordered_map<size_t, std::string> laid_out_text;
+    };
+
+    // Number of characters of the help text of a parser.
+    template <typename P>
+    constexpr size_t help_size(P const & parser, int indentation = 0);
+
+    // Help text of a parser in an array of characters of the given size. For constexpr parsers, dodo_StaticHelp(cli) builds it at
+    // compile time, so showing help takes a single write of read only memory. Default values are written at compile time for the
+    // types whose parse traits can write them to a sink.
+    template <size_t Size, typename P>
+    constexpr static_text<Size> make_static_help(P const & parser, int indentation = 0);
+
+    #define dodo_StaticHelp(cli) dodo::make_static_help<dodo::help_size(cli)>(cli)
+
+    // Writes a description of the commands, options and arguments of a parser, with their patterns, hints, descriptions, default and
+    // implicit values and check messages, for tools that need to know the command line of a program without running it. The format is
+    // either JSON or CBOR, which has the same structure in binary form. The destination may be a string, an output stream or a sink.
+    template <typename P, typename Destination>
+    constexpr void write_schema(P const & parser, Destination && destination, schema_format format = schema_format::json);
+
+    // Number of characters of the schema of a parser.
+    template <typename P>
+    constexpr size_t schema_size(P const & parser, schema_format format = schema_format::json);
+
+    // Schema of a parser in an array of characters of the given size. For constexpr parsers, dodo_StaticSchema(cli, format) builds it at
+    // compile time, so a program can dump it without parsing anything.
+    template <size_t Size, typename P>
+    constexpr static_text<Size> make_static_schema(P const & parser, schema_format format = schema_format::json);
+
+    #define dodo_StaticSchema(cli, format) dodo::make_static_schema<dodo::schema_size(cli, format)>(cli, format)
+
+    // Hash of the schema of a parser and the size of its result, which changes when the options of the parser change. Data that is
+    // written for a parser and read back by another process, such as cached or shared results, is tagged with it, so that data written
+    // by other versions of a program is not read. It can be computed at compile time for constexpr parsers.
+    template <typename P>
+    constexpr uint64_t parser_fingerprint(P const & parser);
+
+    // Fingerprint of a parser with a build ID mixed in, such as the hash of the commit it was built from. Custom parsers and checks are
+    // code that the schema doesn't describe, so programs whose options have them should pass an ID that changes with every build.
+    template <typename P>
+    constexpr uint64_t parser_fingerprint(P const & parser, std::string_view build_id);
+
+    // Size and shape of a parser, for keeping parsers and their results within a budget with static_assert or for tracking them over time.
+    struct parser_footprint
+    {
+        size_t parser_size = 0;             // sizeof the parser.
+        size_t result_size = 0;             // sizeof its parse_result_type.
+        size_t options = 0;
+        size_t patterns = 0;
+        size_t arguments = 0;
+        size_t commands = 0;
+        size_t max_probes_per_token = 0;    // Most names a token may be compared with until the option or command it belongs to is found.
+    };
+
+    // Footprint of a parser, which can be computed at compile time for constexpr parsers. Options are matched by trying their patterns
+    // in order and commands by trying their names in order, so the probes of a token grow with the patterns or the commands of the parser
+    // that reads it. Tool names of a Multicall are found with one probe.
+    template <typename P>
+    constexpr parser_footprint measure_footprint(P const & parser) noexcept;
+
 } // namespace dodo
 
 #include "dodo.inl"
@@ -9,6 +9,22 @@ namespace dodo
             return ParseResultType{ ValueType(t) };
         }
 
+        // Whether the lazy default value of the option is derived from the other options, and so can only be computed once they are parsed.
+        template <typename Option>
+        concept DerivesDefaultValue = HasLazyDefaultValue<Option> && !std::invocable<decltype(Option::compute_default_value) const &>;
+
+        // Value of an option that computes its default value with a function of no parameters. Values that are dodo::lazy are deferred
+        // until they are read.
+        template <typename Option>
+        typename Option::parse_result_type make_lazy_default_value(Option const & option)
+        {
+            using ValueType = typename Option::value_type;
+            if constexpr (instantiation_of<ValueType, lazy>)
+                return typename Option::parse_result_type{ ValueType::deferred(option.compute_default_value) };
+            else
+                return make_parse_result<typename Option::parse_result_type>(option.compute_default_value());
+        }
+
         template <typename ... Args>
         Error<std::string> make_error(Args const & ... args)
         {
@@ -17,105 +33,148 @@ namespace dodo
             return result;
         }
 
-        template <std::predicate<char> P>
-        inline void next_word_unscaped(std::string_view in, size_t & i, char out[], size_t & out_i, P is_delimiter)
+        // Calls f with std::integral_constant<size_t, I>, where I is the given runtime index, which must be lower than N.
+        template <size_t N, typename F>
+        constexpr decltype(auto) visit_index(size_t index, F && f)
         {
-            while (i < in.size())
+            return [&]<size_t ... Is>(std::index_sequence<Is...>) -> decltype(auto)
             {
-                char const c = in[i++];
+                using Result = decltype(f(std::integral_constant<size_t, 0>()));
+                constexpr Result (*table[])(F &) = { [](F & f) -> Result { return f(std::integral_constant<size_t, Is>()); }... };
+                return table[index](f);
+            }(std::make_index_sequence<N>());
+        }
 
-                if (is_delimiter(c))
-                    break;
-                else
-                    out[out_i++] = c;
+        // Sink that forwards to another one and counts the characters written, for padding columns.
+        template <Sink S>
+        struct counted_sink
+        {
+            constexpr void write(std::string_view text)
+            {
+                sink.write(text);
+                count += text.size();
             }
+
+            S & sink;
+            size_t count = 0;
+        };
+
+        // Sink that writes nothing, but measures the columns that the help text written to it needs.
+        struct layout_measuring_sink
+        {
+            constexpr void write(std::string_view) noexcept {}
+
+            help_layout layout = {0, 0, 0};
+        };
+
+        // Tells measuring sinks how long the text to the left of a description is.
+        template <Sink S>
+        constexpr void measure_column(S & sink, size_t help_layout::* column, size_t left_text_length) noexcept
+        {
+            if constexpr (std::is_same_v<S, layout_measuring_sink>)
+                sink.layout.*column = std::max(sink.layout.*column, left_text_length + 2);
         }
 
-        template <std::predicate<char> P>
-        inline void next_word(std::string_view in, size_t & i, char out[], size_t & out_i, P is_delimiter)
+        // Writes a description that starts at the given column of a line that already has line_length characters. If the width is big
+        // enough, the description is word wrapped to it and continuation lines are indented to the column.
+        template <Sink S>
+        constexpr void write_description(S & sink, std::string_view description, size_t column, size_t line_length, size_t width)
         {
-            while (i < in.size())
+            constexpr size_t min_wrapped_width = 20;
+            bool const wrap = width >= column + min_wrapped_width;
+
+            if (line_length < column)
+            {
+                write_spaces(sink, column - line_length);
+            }
+            else if (wrap)
             {
-                char const c = in[i++];
+                // The text to the left does not fit in the column, so the description starts in the next line.
+                sink.write("\n");
+                write_spaces(sink, column);
+            }
 
-                if (is_delimiter(c))
-                    break;
+            if (!wrap)
+            {
+                sink.write(description);
+                return;
+            }
 
-                // Escaping with \ backslash
-                else if (c == '\\')
-                {
-                    out[out_i++] = in[i++];
-                }
-                // Escaping with "double quotes" or 'single quotes'
-                else if (c == '"')
-                {
-                    next_word_unscaped(in, i, out, out_i, [](char c) { return c == '"'; });
-                }
-                else if (c == '\'')
+            size_t const available = width - column;
+            size_t used = 0;
+            while (!description.empty())
+            {
+                size_t const word_end = std::min(description.find_first_of(" \n"), description.size());
+                std::string_view const word = description.substr(0, word_end);
+
+                if (!word.empty())
                 {
-                    next_word_unscaped(in, i, out, out_i, [](char c) { return c == '\''; });
+                    if (used > 0 && used + 1 + word.size() > available)
+                    {
+                        sink.write("\n");
+                        write_spaces(sink, column);
+                        used = 0;
+                    }
+                    else if (used > 0)
+                    {
+                        sink.write(" ");
+                        ++used;
+                    }
+
+                    sink.write(word);
+                    used += word.size();
                 }
-                else
+
+                if (word_end < description.size() && description[word_end] == '\n')
                 {
-                    out[out_i++] = c;
+                    sink.write("\n");
+                    write_spaces(sink, column);
+                    used = 0;
                 }
+
+                description.remove_prefix(std::min(word_end + 1, description.size()));
             }
         }
 
-    } // namespace detail
-
-    inline Args Args::from_command_line(std::string command_line)
-    {
-        Args args;
-        args.buffer = std::move(command_line);
-
-        size_t i = 0;
-        size_t out_i = 0;
-
-        while (i < args.buffer.size())
+        // Line of help with a value of an option, such as its default value.
+        template <Sink S, typename T>
+        constexpr void write_value_line(S & sink, size_t column, std::string_view label, T const & value)
         {
-            size_t const next_word_start = out_i;
-            detail::next_word(args.buffer, i, args.buffer.data(), out_i, [](char c) { return c == ' ' || c == '\t' || c == '\n'; });
-            size_t const next_word_end = out_i;
-
-            size_t const next_word_length = next_word_end - next_word_start;
-            if (next_word_length > 0)
-                args.emplace_back(args.buffer.data() + next_word_start, next_word_length);
+            sink.write("\n");
+            write_spaces(sink, column);
+            sink.write(label);
+            write_value(sink, value);
         }
 
-        return args;
-    }
-
-    inline Args Args::from_command_line_skip_program_name(std::string command_line)
-    {
-        Args args;
-        args.buffer = std::move(command_line);
-
-        size_t i = 0;
-        size_t out_i = 0;
-
-        constexpr auto is_whitespace = [](char c) { return c == ' ' || c == '\t' || c == '\n'; };
-
+        template <typename T>
+        std::string help_to_string(T const & parser, int indentation)
         {
-            char throwaway_buffer[1024];
-            size_t throwaway_out_i = 0;
-            while (throwaway_out_i == 0)
-                detail::next_word(args.buffer, i, throwaway_buffer, throwaway_out_i, is_whitespace);
+            std::string out;
+            string_sink sink{out};
+            parser.write_help(sink, indentation);
+            return out;
         }
 
-        while (i < args.buffer.size())
+        // Parsers and commands defined by the user may only know how to convert their help to a string, or have no help at all.
+        template <Sink S, typename T>
+        constexpr void write_parser_help(S & sink, T const & parser, int indentation, help_layout const & layout)
         {
-            size_t const next_word_start = out_i;
-            detail::next_word(args.buffer, i, args.buffer.data(), out_i, is_whitespace);
-            size_t const next_word_end = out_i;
+            if constexpr (requires { parser.write_help(sink, indentation, layout); })
+                parser.write_help(sink, indentation, layout);
+            else if constexpr (requires { {parser.to_string(indentation)} -> std::convertible_to<std::string_view>; })
+                sink.write(parser.to_string(indentation));
+        }
 
-            size_t const next_word_length = next_word_end - next_word_start;
-            if (next_word_length > 0)
-                args.emplace_back(args.buffer.data() + next_word_start, next_word_length);
+        template <Sink S, CommandType C>
+        constexpr void write_detailed_command_help(S & sink, C const & command, int indentation, help_layout const & layout)
+        {
+            if constexpr (requires { command.write_detailed_help(sink, indentation, layout); })
+                command.write_detailed_help(sink, indentation, layout);
+            else
+                write_parser_help(sink, command, indentation, layout);
         }
 
-        return args;
-    }
+    } // namespace detail
 
     //*****************************************************************************************************************************************************
     // OptionInterface
@@ -143,13 +202,131 @@ namespace dodo
         return std::move(*parse_result);
     }
 
+    namespace detail
+    {
+        template <typename Option>
+        void record_origin(Option const & option, value_sources const & sources, value_origin_kind kind, std::string_view source = {}, uint32_t line = 0)
+        {
+            if (sources.origins == nullptr)
+                return;
+
+            value_origin origin{std::string(sources.section), {}, kind, source, line};
+            option.for_each_pattern([&origin](std::string_view pattern) { if (origin.option.empty()) origin.option = pattern; });
+            sources.origins->push_back(origin);
+        }
+
+        // Parses the value of the option in the profile that was chosen, if one was and it has a value for the option.
+        template <typename Option>
+        auto parse_profile_value(Option const & option, value_sources const & sources) noexcept
+            -> std::optional<expected<typename Option::parse_result_type, std::string>>
+        {
+            if (sources.profile.empty())
+                return std::nullopt;
+
+            profile_value const * value = nullptr;
+            option.for_each_pattern([&](std::string_view pattern)
+            {
+                std::string_view const key = pattern.substr(std::min(pattern.find_first_not_of('-'), pattern.size()));
+                auto const found = std::lower_bound(sources.profile.begin(), sources.profile.end(), key, [](profile_value const & v, std::string_view k) { return v.key < k; });
+                if (value == nullptr && found != sources.profile.end() && found->key == key)
+                    value = &*found;
+            });
+
+            if (value == nullptr)
+                return std::nullopt;
+
+            record_origin(option, sources, value_origin_kind::profile, sources.profile_name);
+            auto parse_result = option.parse(value->value);
+            if (!parse_result)
+                return make_error("In profile ", sources.profile_name, ":\n\t", parse_result.error());
+            return parse_result;
+        }
+
+        // Parses the value of the environment variable of the option, if it has one and it is set.
+        template <typename Option>
+        auto parse_environment_variable([[maybe_unused]] Option const & option, [[maybe_unused]] value_sources const & sources) noexcept
+            -> std::optional<expected<typename Option::parse_result_type, std::string>>
+        {
+            if constexpr (HasEnvironmentVariable<Option>)
+            {
+                if (std::optional<std::string_view> const value = sources.environment.find(option.environment_variable))
+                {
+                    record_origin(option, sources, value_origin_kind::environment, option.environment_variable);
+                    auto parse_result = option.parse(*value);
+                    if (!parse_result)
+                        return make_error("In environment variable ", option.environment_variable, ":\n\t", parse_result.error());
+                    return parse_result;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Parses the value of the option in the config file, if there is one and it has a value for the option.
+        template <typename Option>
+        auto parse_config_value(Option const & option, value_sources const & sources) noexcept
+            -> std::optional<expected<typename Option::parse_result_type, std::string>>
+        {
+            if (sources.config == nullptr)
+                return std::nullopt;
+
+            config_entry const * entry = nullptr;
+            option.for_each_pattern([&](std::string_view pattern)
+            {
+                if (entry == nullptr)
+                    entry = sources.config->find(sources.section, pattern.substr(std::min(pattern.find_first_not_of('-'), pattern.size())));
+            });
+
+            if (entry == nullptr)
+                return std::nullopt;
+
+            record_origin(option, sources, value_origin_kind::config_file, entry->file, entry->line);
+            auto parse_result = option.parse(entry->value);
+            if (!parse_result)
+                return config_error(entry->file, entry->line, parse_result.error());
+            return parse_result;
+        }
+
+        // Parses the value of an option that is not in the command line from the first of the sources that has one.
+        template <typename Option>
+        auto parse_from_sources(Option const & option, value_sources const & sources) noexcept
+            -> std::optional<expected<typename Option::parse_result_type, std::string>>
+        {
+            if (auto profile_result = parse_profile_value(option, sources))
+                return profile_result;
+            if (auto environment_result = parse_environment_variable(option, sources))
+                return environment_result;
+            return parse_config_value(option, sources);
+        }
+
+        // Parses with the sources if the parser takes them, so that parsers that only take arguments can still be composed.
+        template <typename P>
+        auto parse_with_sources(P const & parser, ArgsView args, value_sources const & sources) noexcept
+        {
+            if constexpr (requires { parser.parse(args, sources); })
+                return parser.parse(args, sources);
+            else
+                return parser.parse(args);
+        }
+    }
+
     template <typename Base>
-    auto OptionInterface<Base>::parse(ArgsView args) const noexcept -> expected<typename Base::parse_result_type, std::string>
+    auto OptionInterface<Base>::parse(ArgsView args, value_sources const & sources) const noexcept -> expected<typename Base::parse_result_type, std::string>
     {
         if (args.size() == 0)
         {
+            if (auto sources_result = detail::parse_from_sources(*this, sources))
+                return std::move(*sources_result);
+
             if constexpr (HasDefaultValue<Base>)
+            {
+                detail::record_origin(*this, sources, value_origin_kind::default_value);
                 return detail::make_parse_result<typename Base::parse_result_type>(this->default_value);
+            }
+            else if constexpr (HasLazyDefaultValue<Base> && !detail::DerivesDefaultValue<Base>)
+            {
+                detail::record_origin(*this, sources, value_origin_kind::default_value);
+                return detail::make_lazy_default_value(*this);
+            }
             else
                 return detail::make_error("No matching argument for option ", this->patterns_to_string());
         }
@@ -157,7 +334,10 @@ namespace dodo
         {
             std::optional<std::string_view> const matched = this->match(args[0]);
             if (matched)
+            {
+                detail::record_origin(*this, sources, value_origin_kind::command_line);
                 return this->parse(*matched);
+            }
         }
 
         return detail::make_error(
@@ -169,35 +349,48 @@ namespace dodo
     template <typename Base>
     std::string OptionInterface<Base>::to_string(int indentation) const requires HasDescription<Base>
     {
-        constexpr int column_width = 40;
+        return detail::help_to_string(*this, indentation);
+    }
 
-        std::string out;
-        out.append(indentation, ' ');
-        out += this->patterns_to_string();
-        out += " <";
-        out += this->hint_text();
-        out += ">";
-        while (out.size() < column_width) out.push_back(' ');
-        out += this->description;
+    template <typename Base>
+    template <Sink S>
+    constexpr void OptionInterface<Base>::write_help(S & sink, int indentation, help_layout const & layout) const requires HasDescription<Base>
+    {
+        detail::counted_sink<S> line{sink};
+        write_spaces(line, size_t(indentation));
+        this->write_patterns(line);
+        line.write(" <");
+        line.write(this->hint_text());
+        line.write(">");
+        detail::measure_column(sink, &help_layout::option_column, line.count);
+        detail::write_description(sink, this->description, layout.option_column, line.count, layout.width);
 
         if constexpr (HasDefaultValue<Base>)
-        {
-            out += '\n';
-            for (int i = 0; i < column_width; ++i) out.push_back(' ');
-            out += "By default: ";
-            out += dodo::to_string(this->default_value);
-        }
+            if (layout.values)
+                detail::write_value_line(sink, layout.option_column, "By default: ", this->default_value);
+
+        if constexpr (HasLazyDefaultValue<Base>)
+            if (layout.values)
+                detail::write_value_line(sink, layout.option_column, "By default: ", std::string_view("computed"));
 
         if constexpr (HasImplicitValue<Base>)
+            if (layout.values)
+                detail::write_value_line(sink, layout.option_column, "Implicitly: ", this->implicit_value);
+
+        if constexpr (HasEnvironmentVariable<Base>)
+            detail::write_value_line(sink, layout.option_column, "Environment: ", this->environment_variable);
+
+        if constexpr (HasProfiles<Base>)
         {
-            out += '\n';
-            for (int i = 0; i < column_width; ++i) out.push_back(' ');
-            out += "Implicitly: ";
-            out += dodo::to_string(this->implicit_value);
+            detail::write_value_line(sink, layout.option_column, "Profiles:", std::string_view());
+            for (auto const & p : this->profile_ranges)
+            {
+                sink.write(" ");
+                sink.write(p.name);
+            }
         }
 
-        out += '\n';
-        return out;
+        sink.write("\n");
     }
 
     #undef dodo_Opt
@@ -259,28 +452,28 @@ namespace dodo
     template <typename Base>
     std::string PositionalArgumentInterface<Base>::to_string(int indentation) const requires HasDescription<Base>
     {
-        constexpr int column_width = 40;
+        return detail::help_to_string(*this, indentation);
+    }
 
-        std::string out;
-        out.append(indentation, ' ');
-        out += '[';
-        out += this->name;
-        out += "] <";
-        out += this->hint_text();
-        out += '>';
-        while (out.size() < column_width) out.push_back(' ');
-        out += this->description;
+    template <typename Base>
+    template <Sink S>
+    constexpr void PositionalArgumentInterface<Base>::write_help(S & sink, int indentation, help_layout const & layout) const requires HasDescription<Base>
+    {
+        detail::counted_sink<S> line{sink};
+        write_spaces(line, size_t(indentation));
+        line.write("[");
+        line.write(this->name);
+        line.write("] <");
+        line.write(this->hint_text());
+        line.write(">");
+        detail::measure_column(sink, &help_layout::option_column, line.count);
+        detail::write_description(sink, this->description, layout.option_column, line.count, layout.width);
 
         if constexpr (HasDefaultValue<Base>)
-        {
-            out += '\n';
-            for (int i = 0; i < column_width; ++i) out.push_back(' ');
-            out += "By default: ";
-            out += ::to_string(this->default_value);
-        }
+            if (layout.values)
+                detail::write_value_line(sink, layout.option_column, "By default: ", this->default_value);
 
-        out += '\n';
-        return out;
+        sink.write("\n");
     }
 
     #undef dodo_Arg
@@ -292,7 +485,66 @@ namespace dodo
             constexpr type const & _get() const noexcept { return var; }                                                                \
         };                                                                                                                              \
         return static_cast<OptionTypeImpl *>(nullptr);                                                                                  \
-    }())>>(#type, name))
+    }())>>(name, #type))
+
+    //*****************************************************************************************************************************************************
+    // Names and suggestions
+
+    namespace detail
+    {
+        // Calls f with each name of the parser and the index of the command or option it names.
+        template <ParserWithNames P, typename F>
+        constexpr void for_each_name(P const & parser, F && f)
+        {
+            uint32_t index = 0;
+
+            if constexpr (instantiation_of<P, CommandSelector>)
+            {
+                parser.for_each_command([&](auto const & command)
+                {
+                    if constexpr (NamedCommand<std::remove_cvref_t<decltype(command)>>)
+                        f(std::string_view(command.name), index);
+                    ++index;
+                });
+            }
+            else if constexpr (instantiation_of<P, CompoundParser>)
+            {
+                for_each_name(parser.access_options(), f);
+            }
+            else
+            {
+                parser.for_each_option([&](auto const & option)
+                {
+                    option.for_each_pattern([&](std::string_view pattern) { f(pattern, index); });
+                    ++index;
+                });
+            }
+        }
+
+        template <ParserWithNames P>
+        std::string did_you_mean(P const & parser, std::string_view text)
+        {
+            suggestion_collector collector(text);
+            for_each_name(parser, [&collector](std::string_view name, uint32_t) { collector.consider(name); });
+            return collector.did_you_mean();
+        }
+    }
+
+    template <ParserWithNames P>
+    constexpr size_t name_count(P parser) noexcept
+    {
+        size_t count = 0;
+        detail::for_each_name(parser, [&count](std::string_view, uint32_t) { ++count; });
+        return count;
+    }
+
+    template <size_t Capacity, ParserWithNames P>
+    constexpr suggestion_index<Capacity> make_suggestion_index(P parser) noexcept
+    {
+        suggestion_index<Capacity> index;
+        detail::for_each_name(parser, [&index](std::string_view name, uint32_t) { index.insert(name); });
+        return index;
+    }
 
     //*****************************************************************************************************************************************************
     // CompoundOption
@@ -318,47 +570,253 @@ namespace dodo
     }
 
     template <SingleOption Option>
-    void complete_with_default_value([[maybe_unused]] Option const & parser, [[maybe_unused]] option_parse_result<Option> & result)
+    void complete_with_default_value([[maybe_unused]] Option const & parser, option_parse_result<Option> & result, value_sources const & sources)
     {
+        if (result)
+        {
+            detail::record_origin(parser, sources, value_origin_kind::command_line);
+            return;
+        }
+
+        result = detail::parse_from_sources(parser, sources);
+
         if constexpr (HasDefaultValue<Option>)
+        {
             if (!result)
+            {
+                detail::record_origin(parser, sources, value_origin_kind::default_value);
                 result = option_parse_result<Option>(detail::make_parse_result<typename Option::parse_result_type>(parser.default_value));
+            }
+        }
+
+        // Derived values are left for parse_options, which computes them once the rest of the options are complete.
+        if constexpr (HasLazyDefaultValue<Option> && !detail::DerivesDefaultValue<Option>)
+        {
+            if (!result)
+            {
+                detail::record_origin(parser, sources, value_origin_kind::default_value);
+                result = option_parse_result<Option>(detail::make_lazy_default_value(parser));
+            }
+        }
     }
 
-    template <SingleOption ... Options>
-    auto CompoundOption<Options...>::parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>
+    namespace detail
     {
-        std::tuple<option_parse_result<Options>...> option_parse_results;
+        // Completes an option that chooses a profile, and makes the sources of the rest of the options take the values of the profile.
+        template <SingleOption Option>
+        void complete_profile_option(Option const & option, option_parse_result<Option> & result, value_sources const & sources, value_sources & profiled_sources)
+        {
+            if constexpr (HasProfiles<Option>)
+            {
+                complete_with_default_value(option, result, sources);
+                if (!result || !*result)
+                    return;
+
+                // An empty name, such as that of a default value, chooses no profile.
+                std::string_view const name((**result)._get());
+                if (name.empty())
+                    return;
+
+                if (auto const values = option.find_profile(name))
+                {
+                    profiled_sources.profile = *values;
+                    profiled_sources.profile_name = name;
+                }
+                else
+                {
+                    std::string error = make_error("Unknown profile \"", name, "\". The profiles of ", option.patterns_to_string(), " are:").value;
+                    for (auto const & p : option.profile_ranges)
+                        (error += ' ') += p.name;
+                    result = option_parse_result<Option>(Error(std::move(error)));
+                }
+            }
+        }
+
+        template <SingleOption Option>
+        void complete_with_profile(Option const & option, option_parse_result<Option> & result, value_sources const & sources)
+        {
+            if constexpr (!HasProfiles<Option>)
+                complete_with_default_value(option, result, sources);
+        }
+
+        // Value of an option in the result of parse_options. Options that derive their values from the others hold a placeholder until
+        // they are derived, so only their types need a value to start with.
+        template <SingleOption Option>
+        typename Option::parse_result_type take_parsed_value(option_parse_result<Option> & result)
+        {
+            if constexpr (DerivesDefaultValue<Option>)
+            {
+                using ValueType = typename Option::value_type;
+                if (!result)
+                {
+                    if constexpr (instantiation_of<ValueType, lazy>)
+                        return typename Option::parse_result_type{ ValueType::deferred([]() -> typename ValueType::value_type
+                        {
+                            throw derivation_order_error("An option was derived from an option whose value is derived lazily");
+                        }) };
+                    else
+                    {
+                        static_assert(std::default_initializable<ValueType>, "Options derived from other options must be default initializable or dodo::lazy");
+                        return typename Option::parse_result_type{ ValueType() };
+                    }
+                }
+            }
+            return std::move(**result);
+        }
+
+        template <SingleOption Option, typename Result>
+        void complete_with_derived_value(Option const & option, Result & result, bool missing, value_sources const & sources)
+        {
+            if constexpr (DerivesDefaultValue<Option> && !instantiation_of<typename Option::value_type, lazy>)
+            {
+                if (missing)
+                {
+                    record_origin(option, sources, value_origin_kind::default_value);
+                    static_cast<typename Option::parse_result_type &>(result) =
+                        make_parse_result<typename Option::parse_result_type>(option.compute_default_value(std::as_const(result)));
+                }
+            }
+        }
+
+        template <SingleOption Option>
+        constexpr bool derives_lazy_value = DerivesDefaultValue<Option> && instantiation_of<typename Option::value_type, lazy>;
+
+        // Lazy derived values read a copy of the options taken once the rest have been derived, since the result may be moved or destroyed
+        // before they are read. The copy is shared by all of them, and is taken before any of them is deferred so that it doesn't refer
+        // to itself.
+        template <SingleOption Option, typename Result>
+        void defer_derived_value(Option const & option, Result & result, bool missing, std::shared_ptr<Result const> & options, value_sources const & sources)
+        {
+            if constexpr (derives_lazy_value<Option>)
+            {
+                if (missing)
+                {
+                    static_assert(std::copy_constructible<Result>, "Options whose values are derived lazily must be in copyable options");
+                    record_origin(option, sources, value_origin_kind::default_value);
+                    if (!options)
+                        options = std::make_shared<Result const>(std::as_const(result));
+
+                    using ValueType = typename Option::value_type;
+                    static_cast<typename Option::parse_result_type &>(result) = typename Option::parse_result_type{ ValueType::deferred([options, compute = option.compute_default_value]()
+                    {
+                        return typename ValueType::value_type(compute(*options));
+                    }) };
+                }
+            }
+        }
 
-        for (std::string_view const arg : args)
+        template <SingleOption ... Options>
+        bool match_any_option(CompoundOption<Options...> const & options, std::string_view arg, std::tuple<option_parse_result<Options>...> & results)
         {
-            bool const argument_parsed = (try_parse_argument(
-                access_option<Options>(),
+            return (try_parse_argument(
+                options.template access_option<Options>(),
                 arg,
-                std::get<option_parse_result<Options>>(option_parse_results)
+                std::get<option_parse_result<Options>>(results)
             ) || ...);
-
-            if (!argument_parsed)
-                return detail::make_error("Unrecognized argument \"", arg, '"');
         }
 
-        (complete_with_default_value(access_option<Options>(), std::get<option_parse_result<Options>>(option_parse_results)), ...);
+        // Parses every argument with match_argument, which must find the option the argument belongs to and store the result of parsing it.
+        // Then completes the options that were not found with the values of their environment variables or their default values.
+        template <SingleOption ... Options, typename MatchArgument>
+        auto parse_options(CompoundOption<Options...> const & options, ArgsView args, value_sources const & sources, MatchArgument match_argument) noexcept
+            -> expected<typename CompoundOption<Options...>::parse_result_type, std::string>
+        {
+            // Unless the values of the environment variables were found beforehand, those the options read are all found in one scan of
+            // the environment.
+            constexpr size_t variable_count = (size_t(HasEnvironmentVariable<Options>) + ... + 0);
+            if constexpr (variable_count > 0)
+            {
+                if (!sources.environment.is_indexed())
+                {
+                    std::string_view names[variable_count];
+                    size_t count = 0;
+                    options.for_each_option([&](auto const & option)
+                    {
+                        if constexpr (HasEnvironmentVariable<std::remove_cvref_t<decltype(option)>>)
+                            names[count++] = option.environment_variable;
+                    });
+
+                    environment_index<variable_count> const index(names);
+                    environment_values<variable_count> const values = index.scan();
+                    value_sources indexed_sources = sources;
+                    indexed_sources.environment = values;
+                    return parse_options(options, args, indexed_sources, std::move(match_argument));
+                }
+            }
+
+            std::tuple<option_parse_result<Options>...> option_parse_results;
+
+            for (std::string_view const arg : args)
+            {
+                if (!match_argument(arg, option_parse_results))
+                    return detail::make_error("Unrecognized argument \"", arg, '"', did_you_mean(options, arg.substr(0, arg.find('='))));
+            }
+
+            // Options that choose a profile are completed first, so that the rest can take the values of the profile.
+            value_sources profiled_sources = sources;
+            (complete_profile_option(options.template access_option<Options>(), std::get<option_parse_result<Options>>(option_parse_results), sources, profiled_sources), ...);
+            (complete_with_profile(options.template access_option<Options>(), std::get<option_parse_result<Options>>(option_parse_results), profiled_sources), ...);
 
-        // Check that all options were matched.
-        if (!(std::get<option_parse_result<Options>>(option_parse_results) && ...))
-            return detail::make_error("Unmatched option");
+            // Check that all options were matched, except those that derive their values from the others.
+            if (!((std::get<option_parse_result<Options>>(option_parse_results) || DerivesDefaultValue<Options>) && ...))
+                return detail::make_error("Unmatched option");
 
-        // Check that no option failed to parse.
-        if (!(*std::get<option_parse_result<Options>>(option_parse_results) && ...))
-            return detail::make_error("Option failed to parse");
+            // Check that no option failed to parse, and report the error of the first one that did.
+            auto const parsed = [](auto const & result) { return !result || *result; };
+            if (!(parsed(std::get<option_parse_result<Options>>(option_parse_results)) && ...))
+            {
+                std::string error;
+                auto const take_error = [&error](auto & result) { if (error.empty() && result && !*result) error = std::move(result->error()); };
+                (take_error(std::get<option_parse_result<Options>>(option_parse_results)), ...);
+                return Error(std::move(error));
+            }
+
+            if constexpr (!(DerivesDefaultValue<Options> || ...))
+                return typename CompoundOption<Options...>::parse_result_type{std::move(**std::get<option_parse_result<Options>>(option_parse_results))...};
+            else
+            {
+                // Derived values are computed in the order of the options, so they may be derived from those that come before them.
+                using Result = typename CompoundOption<Options...>::parse_result_type;
+                bool const missing[] = {!std::get<option_parse_result<Options>>(option_parse_results)...};
+                Result result{take_parsed_value<Options>(std::get<option_parse_result<Options>>(option_parse_results))...};
+                try
+                {
+                    size_t i = 0;
+                    (complete_with_derived_value(options.template access_option<Options>(), result, missing[i++], sources), ...);
+                }
+                catch (derivation_order_error const & error)
+                {
+                    return make_error(error.what());
+                }
+
+                if constexpr ((derives_lazy_value<Options> || ...))
+                {
+                    std::shared_ptr<Result const> shared_options;
+                    size_t i = 0;
+                    (defer_derived_value(options.template access_option<Options>(), result, missing[i++], shared_options, sources), ...);
+                }
+                return result;
+            }
+        }
+    }
 
-        return parse_result_type{std::move(**std::get<option_parse_result<Options>>(option_parse_results))...};
+    template <SingleOption ... Options>
+    auto CompoundOption<Options...>::parse(ArgsView args, value_sources const & sources) const noexcept -> expected<parse_result_type, std::string>
+    {
+        return detail::parse_options(*this, args, sources, [this](std::string_view arg, auto & results) { return detail::match_any_option(*this, arg, results); });
     }
 
     template <SingleOption ... Options>
     std::string CompoundOption<Options...>::to_string(int indentation) const
     {
-        return (this->template access_option<Options>().to_string(indentation) + ...);
+        return detail::help_to_string(*this, indentation);
+    }
+
+    template <SingleOption ... Options>
+    template <Sink S>
+    constexpr void CompoundOption<Options...>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        (this->template access_option<Options>().write_help(sink, indentation, layout), ...);
     }
 
     template <SingleOption A, SingleOption B>
@@ -413,7 +871,14 @@ namespace dodo
     template <SingleArgument ... Arguments>
     std::string CompoundArgument<Arguments...>::to_string(int indentation) const
     {
-        return (this->template access_argument<Arguments>().to_string(indentation) + ...);
+        return detail::help_to_string(*this, indentation);
+    }
+
+    template <SingleArgument ... Arguments>
+    template <Sink S>
+    constexpr void CompoundArgument<Arguments...>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        (this->template access_argument<Arguments>().write_help(sink, indentation, layout), ...);
     }
 
     template <SingleArgument A, SingleArgument B>
@@ -446,7 +911,7 @@ namespace dodo
     // CompoundParser
 
     template <instantiation_of<CompoundArgument> Arguments, instantiation_of<CompoundOption> Options>
-    auto CompoundParser<Arguments, Options>::parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>
+    auto CompoundParser<Arguments, Options>::parse(ArgsView args, value_sources const & sources) const noexcept -> expected<parse_result_type, std::string>
     {
         auto const first_option = std::find_if(args.begin(), args.end(), [](std::string_view arg) { return arg[0] == '-'; });
         size_t const positional_arg_count = size_t(first_option - args.begin());
@@ -455,7 +920,7 @@ namespace dodo
         if (!parsed_args)
             return Error(std::move(parsed_args.error()));
 
-        auto opts = Options::parse(args.last(args.size() - positional_arg_count));
+        auto opts = Options::parse(args.last(args.size() - positional_arg_count), sources);
         if (!opts)
             return Error(std::move(opts.error()));
 
@@ -465,17 +930,20 @@ namespace dodo
     template <instantiation_of<CompoundArgument> Arguments, instantiation_of<CompoundOption> Options>
     std::string CompoundParser<Arguments, Options>::to_string(int indentation) const
     {
-        std::string out;
-
-        out.append(indentation, ' ');
-        out += "Arguments:\n";
-        out += Arguments::to_string(indentation + 2);
-        out += '\n';
-        out.append(indentation, ' ');
-        out += "Options:\n";
-        out += Options::to_string(indentation + 2);
+        return detail::help_to_string(*this, indentation);
+    }
 
-        return out;
+    template <instantiation_of<CompoundArgument> Arguments, instantiation_of<CompoundOption> Options>
+    template <Sink S>
+    constexpr void CompoundParser<Arguments, Options>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        write_spaces(sink, size_t(indentation));
+        sink.write("Arguments:\n");
+        Arguments::write_help(sink, indentation + 2, layout);
+        sink.write("\n");
+        write_spaces(sink, size_t(indentation));
+        sink.write("Options:\n");
+        Options::write_help(sink, indentation + 2, layout);
     }
 
     template <SingleArgument A, SingleOption B>
@@ -545,64 +1013,200 @@ namespace dodo
 
     namespace detail
     {
-        template <CommandType Next, CommandType ... Rest, CommandType ... Commands>
-        constexpr auto parse_impl(CommandSelector<Commands...> const & commands, ArgsView args) noexcept
-            -> expected<typename CommandSelector<Commands...>::parse_result_type, std::string>
+        template <CommandType Command>
+        auto parse_command_with_sources(Command const & command, ArgsView args, value_sources const & sources) noexcept
         {
-            Next const & next = commands.access_command<Next>();
-            if (next.match(args[0]))
-            {
-                auto result = next.parse_command(args);
-                if (!result)
-                    return Error(std::move(result.error()));
-                else
-                    return std::move(*result);
-            }
+            if constexpr (requires { command.parse_command(args, sources); })
+                return command.parse_command(args, sources);
             else
-            {
-                if constexpr (sizeof...(Rest) > 0)
-                    return dodo::detail::parse_impl<Rest...>(commands, args);
-                else
-                    return detail::make_error("Unrecognized command \"", args[0], '"');
-            }
+                return command.parse_command(args);
+        }
+
+        // Calls on_match with the index of the first command that matches the given text and the command itself.
+        // Calls on_unmatched if no command matches.
+        template <size_t I = 0, CommandType ... Commands, typename OnMatch, typename OnUnmatched>
+        constexpr auto dispatch_command(CommandSelector<Commands...> const & commands, std::string_view text, OnMatch on_match, OnUnmatched on_unmatched)
+        {
+            using Next = std::tuple_element_t<I, std::tuple<Commands...>>;
+
+            Next const & next = commands.template access_command<Next>();
+            if (next.match(text))
+                return on_match(std::integral_constant<size_t, I>(), next);
+            else if constexpr (I + 1 < sizeof...(Commands))
+                return dodo::detail::dispatch_command<I + 1>(commands, text, on_match, on_unmatched);
+            else
+                return on_unmatched();
         }
     }
 
     template <CommandType ... Commands>
-    auto CommandSelector<Commands...>::parse(ArgsView args) const noexcept -> expected<parse_result_type, std::string>
+    auto CommandSelector<Commands...>::parse(ArgsView args, value_sources const & sources) const noexcept -> expected<parse_result_type, std::string>
     {
         if (args.size() <= 0)
             return detail::make_error("Expected command.");
 
-        return dodo::detail::parse_impl<Commands...>(*this, args);
+        return detail::dispatch_command(*this, args[0],
+            [this, args, &sources](auto index, auto const &) { return parse_with_command<index>(args, sources); },
+            [this, args]() -> expected<parse_result_type, std::string>
+            {
+                return detail::make_error("Unrecognized command \"", args[0], '"', detail::did_you_mean(*this, args[0]));
+            });
     }
 
     template <CommandType ... Commands>
-    std::string CommandSelector<Commands...>::to_string(int indentation) const noexcept
+    template <size_t I>
+    auto CommandSelector<Commands...>::parse_with_command(ArgsView args, value_sources const & sources) const noexcept -> expected<parse_result_type, std::string>
     {
-        return (access_command<Commands>().to_string(indentation) + ...);
+        auto result = detail::parse_command_with_sources(access_command<I>(), args, sources);
+        if (!result)
+            return Error(std::move(result.error()));
+        else
+            return parse_result_type(std::in_place_index<I>, std::move(*result));
     }
 
-    template <Parser P>
-    constexpr auto Command<P>::parse_command(ArgsView args) const noexcept
+    template <CommandType ... Commands>
+    auto CommandSelector<Commands...>::parse_compact(ArgsView args, std::pmr::memory_resource * resource, value_sources const & sources) const noexcept
+        -> expected<compact_parse_result_type, std::string>
     {
-        return parser.parse(args.last(args.size() - 1));
+        if (args.size() <= 0)
+            return detail::make_error("Expected command.");
+
+        return detail::dispatch_command(*this, args[0],
+            [args, resource, &sources](auto index, auto const & command) -> expected<compact_parse_result_type, std::string>
+            {
+                auto result = detail::parse_command_with_sources(command, args, sources);
+                if (!result)
+                    return Error(std::move(result.error()));
+                else
+                    return compact_parse_result_type(std::in_place_index<index>, resource, std::move(*result));
+            },
+            [this, args]() -> expected<compact_parse_result_type, std::string>
+            {
+                return detail::make_error("Unrecognized command \"", args[0], '"', detail::did_you_mean(*this, args[0]));
+            });
     }
 
-    template <Parser P>
-    std::string Command<P>::to_string(int indentation) const noexcept
+    template <CommandType ... Commands>
+    template <std::invocable<expected<typename CommandSelector<Commands...>::parse_result_type, std::string>> Handler>
+    size_t CommandSelector<Commands...>::dispatch_batch(std::span<Args const> batch, Handler && handler) const
     {
-        constexpr int column_width = 25;
+        std::vector<std::optional<expected<parse_result_type, std::string>>> results(batch.size());
+        std::unordered_set<std::string> seen_keys[command_count];
 
-        std::string out;
+        // Walking the batch backwards, the first command seen with each key is the one that is kept.
+        for (size_t i = batch.size(); i-- > 0; )
+        {
+            auto result = parse(batch[i]);
 
-        out.append(indentation, ' ');
-        out += name;
-        while (out.size() < column_width) out.push_back(' ');
-        out += description;
-        out += '\n';
+            bool const superseded = result && detail::visit_index<command_count>(result->index(), [&](auto index)
+            {
+                using C = std::tuple_element_t<index, std::tuple<Commands...>>;
+                if constexpr (Coalescing<C>)
+                    return !seen_keys[index].insert(access_command<C>().coalescing_key(std::get<index>(*result))).second;
+                else
+                    return false;
+            });
 
-        return out;
+            if (!superseded)
+                results[i] = std::move(result);
+        }
+
+        size_t dispatched = 0;
+        for (auto & result : results)
+        {
+            if (result)
+            {
+                handler(std::move(*result));
+                ++dispatched;
+            }
+        }
+        return dispatched;
+    }
+
+    template <CommandType ... Commands>
+    template <Sink S>
+    constexpr bool CommandSelector<Commands...>::write_help_for(std::string_view command_name, S & sink, int indentation, help_layout const & layout) const
+    {
+        return detail::dispatch_command(*this, command_name,
+            [&](auto, auto const & command)
+            {
+                detail::write_detailed_command_help(sink, command, indentation, layout);
+                return true;
+            },
+            []() { return false; });
+    }
+
+    template <CommandType ... Commands>
+    std::optional<std::string> CommandSelector<Commands...>::help_for(std::string_view command_name) const
+    {
+        std::string out;
+        string_sink sink{out};
+        if (write_help_for(command_name, sink))
+            return out;
+        else
+            return std::nullopt;
+    }
+
+    template <CommandType ... Commands>
+    std::string CommandSelector<Commands...>::to_string(int indentation) const noexcept
+    {
+        return detail::help_to_string(*this, indentation);
+    }
+
+    template <CommandType ... Commands>
+    template <Sink S>
+    constexpr void CommandSelector<Commands...>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        (detail::write_parser_help(sink, access_command<Commands>(), indentation, layout), ...);
+    }
+
+    template <Parser P>
+    constexpr auto Command<P>::parse_command(ArgsView args, value_sources const & sources) const noexcept
+    {
+        // Nested commands are in the section of the whole path of commands, so that "remote add" doesn't share the section of "add".
+        value_sources command_sources = sources;
+        std::string path;
+        if (sources.section.empty())
+            command_sources.section = name;
+        else
+        {
+            path.append(sources.section).append(1, '.').append(name);
+            command_sources.section = path;
+        }
+        return detail::parse_with_sources(parser, args.last(args.size() - 1), command_sources);
+    }
+
+    template <Parser P>
+    template <typename KeyFunction>
+    constexpr CoalescingCommand<Command<P>, KeyFunction> Command<P>::coalesce_by(KeyFunction key_function) const noexcept
+    {
+        return CoalescingCommand<Command<P>, KeyFunction>(*this, key_function);
+    }
+
+    template <Parser P>
+    std::string Command<P>::to_string(int indentation) const noexcept
+    {
+        return detail::help_to_string(*this, indentation);
+    }
+
+    template <Parser P>
+    template <Sink S>
+    constexpr void Command<P>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        detail::counted_sink<S> line{sink};
+        write_spaces(line, size_t(indentation));
+        line.write(name);
+        detail::measure_column(sink, &help_layout::command_column, line.count);
+        detail::write_description(sink, description, layout.command_column, line.count, layout.width);
+        sink.write("\n");
+    }
+
+    template <Parser P>
+    template <Sink S>
+    constexpr void Command<P>::write_detailed_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        write_help(sink, indentation, layout);
+        detail::write_parser_help(sink, parser, indentation + 2, layout);
     }
 
     template <CommandType A, CommandType B>
@@ -630,7 +1234,7 @@ namespace dodo
     }
 
     template <Parser SharedOptions, instantiation_of<CommandSelector> Commands>
-    auto CommandWithSharedOptions<SharedOptions, Commands>::parse(ArgsView args) const noexcept
+    auto CommandWithSharedOptions<SharedOptions, Commands>::parse(ArgsView args, value_sources const & sources) const noexcept
         -> expected<parse_result_type, std::string>
     {
         auto const it = std::find_if(args.begin(), args.end(), [this](std::string_view arg) { return commands.match(arg); });
@@ -641,11 +1245,11 @@ namespace dodo
 
         size_t const arguments_until_command = size_t(it - args.begin());
 
-        auto shared_arguments = shared_options.parse(args.first(arguments_until_command));
+        auto shared_arguments = detail::parse_with_sources(shared_options, args.first(arguments_until_command), sources);
         if (!shared_arguments)
             return Error(std::move(shared_arguments.error()));
 
-        auto command = commands.parse(args.last(args.size() - arguments_until_command));
+        auto command = commands.parse(args.last(args.size() - arguments_until_command), sources);
         if (!command)
             return Error(std::move(command.error()));
 
@@ -655,15 +1259,20 @@ namespace dodo
     template <Parser SharedOptions, instantiation_of<CommandSelector> Commands>
     std::string CommandWithSharedOptions<SharedOptions, Commands>::to_string(int indentation) const noexcept
     {
-        std::string out;
-        out.append(indentation, ' ');
-        out += "Shared options:\n";
-        out += shared_options.to_string(indentation + 2);
-        out += '\n';
-        out.append(indentation, ' ');
-        out += "Commands:\n";
-        out += commands.to_string(indentation + 2);
-        return out;
+        return detail::help_to_string(*this, indentation);
+    }
+
+    template <Parser SharedOptions, instantiation_of<CommandSelector> Commands>
+    template <Sink S>
+    constexpr void CommandWithSharedOptions<SharedOptions, Commands>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        write_spaces(sink, size_t(indentation));
+        sink.write("Shared options:\n");
+        detail::write_parser_help(sink, shared_options, indentation + 2, layout);
+        sink.write("\n");
+        write_spaces(sink, size_t(indentation));
+        sink.write("Commands:\n");
+        commands.write_help(sink, indentation + 2, layout);
     }
 
     template <Parser P, CommandType Command>
@@ -680,12 +1289,12 @@ namespace dodo
     }
 
     template <instantiation_of<CommandSelector> Commands, Parser ImplicitCommand>
-    auto CommandWithImplicitCommand<Commands, ImplicitCommand>::parse(ArgsView args) const noexcept
+    auto CommandWithImplicitCommand<Commands, ImplicitCommand>::parse(ArgsView args, value_sources const & sources) const noexcept
         -> expected<parse_result_type, std::string>
     {
         if (commands.match(args[0]))
         {
-            auto parsed_command = commands.parse(args);
+            auto parsed_command = commands.parse(args, sources);
             if (!parsed_command)
                 return Error(std::move(parsed_command.error()));
             else
@@ -693,7 +1302,7 @@ namespace dodo
         }
         else
         {
-            auto parsed_implicit_command = implicit_command.parse(args);
+            auto parsed_implicit_command = detail::parse_with_sources(implicit_command, args, sources);
             if (!parsed_implicit_command)
                 return Error(std::move(parsed_implicit_command.error()));
             else
@@ -704,15 +1313,20 @@ namespace dodo
     template <instantiation_of<CommandSelector> Commands, Parser ImplicitCommand>
     std::string CommandWithImplicitCommand<Commands, ImplicitCommand>::to_string(int indentation) const noexcept
     {
-        std::string out;
-        out.append(indentation, ' ');
-        out += "Commands:\n";
-        out += commands.to_string(indentation + 2);
-        out += '\n';
-        out.append(indentation, ' ');
-        out += "Options:\n";
-        out += implicit_command.to_string(indentation + 2);
-        return out;
+        return detail::help_to_string(*this, indentation);
+    }
+
+    template <instantiation_of<CommandSelector> Commands, Parser ImplicitCommand>
+    template <Sink S>
+    constexpr void CommandWithImplicitCommand<Commands, ImplicitCommand>::write_help(S & sink, int indentation, help_layout const & layout) const
+    {
+        write_spaces(sink, size_t(indentation));
+        sink.write("Commands:\n");
+        commands.write_help(sink, indentation + 2, layout);
+        sink.write("\n");
+        write_spaces(sink, size_t(indentation));
+        sink.write("Options:\n");
+        detail::write_parser_help(sink, implicit_command, indentation + 2, layout);
     }
 
     template <CommandType Command, Parser ImplicitCommand>
@@ -735,6 +1349,1263 @@ namespace dodo
             (commands.commands, commands.implicit_command | new_implicit_command);
     }
 
+    //*****************************************************************************************************************************************************
+    // Abbreviated
+
+    namespace detail
+    {
+        template <typename P>
+        constexpr bool has_unnamed_commands = false;
+
+        template <CommandType ... Commands>
+        constexpr bool has_unnamed_commands<CommandSelector<Commands...>> = !(NamedCommand<Commands> && ...);
+
+        template <SingleOption ... Options, size_t TrieCapacity>
+        auto parse_abbreviated_options(CompoundOption<Options...> const & options, prefix_trie<TrieCapacity> const & trie, ArgsView args,
+            value_sources const & sources) noexcept -> expected<typename CompoundOption<Options...>::parse_result_type, std::string>
+        {
+            return parse_options(options, args, sources, [&](std::string_view arg, auto & results)
+            {
+                size_t const equals = arg.find('=');
+                std::string_view const name = arg.substr(0, equals);
+
+                // A prefix made only of dashes is not an abbreviation of anything.
+                prefix_match const match = name.find_first_not_of('-') == std::string_view::npos ? prefix_match() : trie.find(name);
+                if (!match)
+                    return match_any_option(options, arg, results);
+
+                return visit_index<sizeof...(Options)>(match.value, [&](auto index)
+                {
+                    auto & result = std::get<index>(results);
+                    if (result)
+                        return false;
+
+                    std::string_view const value = equals == std::string_view::npos ? std::string_view() : arg.substr(equals + 1);
+                    result = std::tuple_element_t<index, std::remove_reference_t<decltype(results)>>(options.template access_option<index>().parse(value));
+                    return true;
+                });
+            });
+        }
+    }
+
+    template <ParserWithNames P>
+    constexpr size_t abbreviation_trie_capacity(P parser) noexcept
+    {
+        size_t capacity = 1;
+        detail::for_each_name(parser, [&capacity](std::string_view word, uint32_t) { capacity += word.size(); });
+        return capacity;
+    }
+
+    template <ParserWithNames P, size_t TrieCapacity>
+    constexpr Abbreviated<P, TrieCapacity>::Abbreviated(P parser) noexcept
+        : P(parser)
+    {
+        detail::for_each_name(parser, [this](std::string_view word, uint32_t index) { trie.insert(word, index); });
+    }
+
+    template <ParserWithNames P, size_t TrieCapacity>
+    auto Abbreviated<P, TrieCapacity>::parse(ArgsView args, value_sources const & sources) const noexcept -> expected<parse_result_type, std::string>
+    {
+        if constexpr (instantiation_of<P, CommandSelector>)
+        {
+            if (args.size() > 0)
+            {
+                // Commands that are matched by other means than their name take precedence over abbreviations.
+                prefix_match const match = trie.find(args[0]);
+                if (match.kind == prefix_match_kind::exact || (match && !(detail::has_unnamed_commands<P> && P::match(args[0]))))
+                    return detail::visit_index<P::command_count>(match.value, [this, args, &sources](auto index) { return this->template parse_with_command<index>(args, sources); });
+                else if (match.kind == prefix_match_kind::ambiguous && !P::match(args[0]))
+                    return detail::make_error("Ambiguous command \"", args[0], '"');
+            }
+
+            return P::parse(args, sources);
+        }
+        else if constexpr (instantiation_of<P, CompoundOption>)
+        {
+            return detail::parse_abbreviated_options(static_cast<P const &>(*this), trie, args, sources);
+        }
+        else
+        {
+            auto const first_option = std::find_if(args.begin(), args.end(), [](std::string_view arg) { return arg[0] == '-'; });
+            size_t const positional_arg_count = size_t(first_option - args.begin());
+
+            auto parsed_args = this->access_arguments().parse(args.first(positional_arg_count));
+            if (!parsed_args)
+                return Error(std::move(parsed_args.error()));
+
+            auto opts = detail::parse_abbreviated_options(this->access_options(), trie, args.last(args.size() - positional_arg_count), sources);
+            if (!opts)
+                return Error(std::move(opts.error()));
+
+            return parse_result_type{std::move(*parsed_args), std::move(*opts)};
+        }
+    }
+
+    //*****************************************************************************************************************************************************
+    // Multicall
+
+    constexpr std::string_view program_basename(std::string_view path) noexcept
+    {
+        size_t const last_separator = path.find_last_of("/\\");
+        if (last_separator != std::string_view::npos)
+            path.remove_prefix(last_separator + 1);
+
+        if (path.ends_with(".exe"))
+            path.remove_suffix(4);
+
+        return path;
+    }
+
+    namespace detail
+    {
+        template <instantiation_of<CommandSelector> Commands>
+        constexpr perfect_hash<Commands::named_command_count> make_tool_hash(Commands const & commands) noexcept
+        {
+            std::string_view names[Commands::named_command_count > 0 ? Commands::named_command_count : 1] = {};
+            uint32_t indices[Commands::named_command_count > 0 ? Commands::named_command_count : 1] = {};
+            size_t count = 0;
+            for_each_name(commands, [&](std::string_view name, uint32_t index)
+            {
+                names[count] = name;
+                indices[count] = index;
+                ++count;
+            });
+            return perfect_hash<Commands::named_command_count>(std::span(names, count), std::span(indices, count));
+        }
+    }
+
+    template <instantiation_of<CommandSelector> Commands>
+    constexpr Multicall<Commands>::Multicall(std::string_view program_name_, Commands commands_) noexcept
+        : program_name(program_name_)
+        , commands(std::move(commands_))
+        , tools(detail::make_tool_hash(commands))
+    {}
+
+    template <instantiation_of<CommandSelector> Commands>
+    auto Multicall<Commands>::parse(ArgsView args, value_sources const & sources) const noexcept -> expected<parse_result_type, std::string>
+    {
+        if (args.size() <= 0)
+            return detail::make_error("Expected program name.");
+
+        auto const parse_tool = [this, &sources](uint32_t tool, ArgsView tool_args)
+        {
+            return detail::visit_index<Commands::command_count>(tool, [this, tool_args, &sources](auto index) { return commands.template parse_with_command<index>(tool_args, sources); });
+        };
+
+        std::string_view const name = program_basename(args[0]);
+        if (std::optional<uint32_t> const tool = tools.find(name))
+            return parse_tool(*tool, args);
+        else if (name != program_name)
+            return detail::make_error("Unrecognized program name \"", name, '"', detail::did_you_mean(commands, name));
+
+        // Called by the name of the binary, the tool is the first argument.
+        if (args.size() <= 1)
+            return detail::make_error("Expected command.");
+        else if (std::optional<uint32_t> const tool = tools.find(args[1]))
+            return parse_tool(*tool, args.last(args.size() - 1));
+        else
+            return detail::make_error("Unrecognized command \"", args[1], '"', detail::did_you_mean(commands, args[1]));
+    }
+
+    //*****************************************************************************************************************************************************
+    // Traversal
+
+    namespace detail
+    {
+        // Result that traversals which don't read or write results carry along the parsers.
+        struct no_result {};
+
+        // Parts of the result of a node for its children, for traversals that carry pointers into a result. They are null for the
+        // commands that were not chosen, and for all of them if the result is null.
+        template <size_t I>
+        constexpr no_result alternative_result(no_result) noexcept { return {}; }
+        template <size_t I, typename Variant>
+        constexpr auto alternative_result(Variant * result) noexcept { return std::get_if<I>(result); }
+
+        constexpr no_result shared_arguments_result(no_result) noexcept { return {}; }
+        template <typename Result>
+        constexpr auto shared_arguments_result(Result * result) noexcept { return result != nullptr ? &result->shared_arguments : nullptr; }
+
+        constexpr no_result command_result(no_result) noexcept { return {}; }
+        template <typename Result>
+        constexpr auto command_result(Result * result) noexcept { return result != nullptr ? &result->command : nullptr; }
+
+        // Calls the member of the visitor for the kind of the parser, with the parser and its result, and returns what it returns.
+        template <typename P, typename R, typename Visitor>
+        constexpr decltype(auto) visit_parser(P const & parser, R result, Visitor & visitor)
+        {
+            if constexpr (requires { typename P::base_parser_type; })
+                return visitor.visit_abbreviated(static_cast<typename P::base_parser_type const &>(parser), result);
+            else if constexpr (instantiation_of<P, CommandSelector>)
+                return visitor.visit_commands(parser, result);
+            else if constexpr (instantiation_of<P, CompoundOption>)
+                return visitor.visit_options(parser, result);
+            else if constexpr (instantiation_of<P, CompoundArgument>)
+                return visitor.visit_arguments(parser, result);
+            else if constexpr (instantiation_of<P, CompoundParser>)
+                return visitor.visit_compound(parser, result);
+            else if constexpr (instantiation_of<P, Multicall>)
+                return visitor.visit_multicall(parser, result);
+            else if constexpr (instantiation_of<P, CommandWithSharedOptions>)
+                return visitor.visit_shared_options(parser, result);
+            else if constexpr (instantiation_of<P, CommandWithImplicitCommand>)
+                return visitor.visit_implicit_command(parser, result);
+            else if constexpr (SingleOption<P>)
+                return visitor.visit_option(parser, result);
+            else if constexpr (SingleArgument<P>)
+                return visitor.visit_argument(parser, result);
+            else
+                return visitor.visit_other(parser, result);
+        }
+
+        // Base of the visitors of visit_parser, whose members visit the children of each kind of parser and do nothing for options and
+        // arguments. Visitors derive from it, giving their own type, and hide the members for the parsers they handle. A new kind of
+        // parser takes a branch in visit_parser and a member here.
+        template <typename Visitor>
+        struct parser_visitor
+        {
+            template <typename P, typename R>
+            constexpr decltype(auto) visit_abbreviated(P const & parser, R result) { return visit_parser(parser, result, self()); }
+
+            template <typename P, typename R>
+            constexpr void visit_commands(P const & commands, R result)
+            {
+                [&]<size_t ... I>(std::index_sequence<I...>)
+                {
+                    (self().visit_command(commands.template access_command<I>(), alternative_result<I>(result)), ...);
+                }(std::make_index_sequence<P::command_count>());
+            }
+
+            template <typename C, typename R>
+            constexpr void visit_command(C const & command, R result)
+            {
+                if constexpr (requires { command.parser; })
+                    visit_parser(command.parser, result, self());
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_options(P const & options, R result)
+            {
+                options.for_each_option([&](auto const & option) { visit_parser(option, result, self()); });
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_arguments(P const & arguments, R result)
+            {
+                arguments.for_each_argument([&](auto const & argument) { visit_parser(argument, result, self()); });
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_compound(P const & parser, R result)
+            {
+                visit_parser(parser.access_arguments(), result, self());
+                visit_parser(parser.access_options(), result, self());
+            }
+
+            template <typename P, typename R>
+            constexpr decltype(auto) visit_multicall(P const & parser, R result) { return visit_parser(parser.commands, result, self()); }
+
+            template <typename P, typename R>
+            constexpr void visit_shared_options(P const & parser, R result)
+            {
+                visit_parser(parser.shared_options, shared_arguments_result(result), self());
+                visit_parser(parser.commands, command_result(result), self());
+            }
+
+            // The result holds the alternatives of the commands followed by the one of the implicit command.
+            template <typename P, typename R>
+            constexpr void visit_implicit_command(P const & parser, R result)
+            {
+                constexpr size_t command_count = std::remove_cvref_t<decltype(parser.commands)>::command_count;
+                if constexpr (std::is_pointer_v<R>)
+                    static_assert(std::variant_size_v<std::remove_cv_t<std::remove_pointer_t<R>>> == command_count + 1,
+                        "Implicit commands that are command selectors can't be visited with their results");
+
+                visit_parser(parser.commands, result, self());
+                visit_parser(parser.implicit_command, alternative_result<command_count>(result), self());
+            }
+
+            template <typename P, typename R> constexpr void visit_option(P const &, R) {}
+            template <typename P, typename R> constexpr void visit_argument(P const &, R) {}
+            template <typename P, typename R> constexpr void visit_other(P const &, R) {}
+
+        private:
+            constexpr Visitor & self() noexcept { return static_cast<Visitor &>(*this); }
+        };
+    }
+
+    //*****************************************************************************************************************************************************
+    // Help requests
+
+    namespace detail
+    {
+        template <typename P>
+        concept with_commands = instantiation_of<P, CommandSelector> || instantiation_of<std::remove_cvref_t<decltype(std::declval<P>().commands)>, CommandSelector>;
+
+        template <with_commands P>
+        constexpr auto const & commands_of(P const & parser) noexcept
+        {
+            if constexpr (instantiation_of<P, CommandSelector>)
+                return parser;
+            else
+                return parser.commands;
+        }
+
+        template <CommandType ... Commands>
+        constexpr std::string_view command_named(CommandSelector<Commands...> const & commands, std::string_view text) noexcept
+        {
+            std::string_view found;
+            commands.for_each_command([&](auto const & command)
+            {
+                if constexpr (NamedCommand<std::remove_cvref_t<decltype(command)>>)
+                    if (found.empty() && command.name == text)
+                        found = command.name;
+            });
+            return found;
+        }
+    }
+
+    namespace detail
+    {
+        // Position of the first help token in the arguments, or the number of arguments if there is none.
+        constexpr size_t find_help_token(ArgsView args, std::span<std::string_view const> help_tokens) noexcept
+        {
+            return size_t(std::find_if(args.begin(), args.end(), [help_tokens](std::string_view arg)
+            {
+                return std::find(help_tokens.begin(), help_tokens.end(), arg) != help_tokens.end();
+            }) - args.begin());
+        }
+
+        // The help token itself may be the name of a command, as in "help" and "help clean", so it is skipped.
+        template <typename FindCommand>
+        constexpr std::optional<help_request> help_request_at(ArgsView args, size_t help_token, FindCommand find_command) noexcept
+        {
+            if (help_token == args.size())
+                return std::nullopt;
+
+            for (size_t i = 0; i < args.size(); ++i)
+                if (i != help_token)
+                    if (std::string_view const command = find_command(args[i]); !command.empty())
+                        return help_request{command};
+            return help_request{};
+        }
+    }
+
+    template <typename P>
+    constexpr std::optional<help_request> find_help_request(P const & parser, ArgsView args, std::span<std::string_view const> help_tokens) noexcept
+    {
+        return detail::help_request_at(args, detail::find_help_token(args, help_tokens), [&parser](std::string_view arg)
+        {
+            if constexpr (detail::with_commands<P>)
+                return detail::command_named(detail::commands_of(parser), arg);
+            else
+                return std::string_view();
+        });
+    }
+
+    template <typename P, size_t Capacity>
+    constexpr std::optional<help_request> find_help_request(P const & parser, perfect_hash<Capacity> const & command_names, ArgsView args,
+        std::span<std::string_view const> help_tokens) noexcept
+    {
+        return detail::help_request_at(args, detail::find_help_token(args, help_tokens), [&](std::string_view arg)
+        {
+            // The name is taken from the parser, so that the request doesn't point into the arguments.
+            std::string_view name;
+            if (std::optional<uint32_t> const command = command_names.find(arg))
+                detail::for_each_name(detail::commands_of(parser), [&](std::string_view n, uint32_t index) { if (index == *command) name = n; });
+            return name;
+        });
+    }
+
+    template <typename P>
+    constexpr auto make_command_names(P const & parser) noexcept
+    {
+        return detail::make_tool_hash(detail::commands_of(parser));
+    }
+
+    //*****************************************************************************************************************************************************
+    // Help
+
+    template <typename P, typename Destination>
+    constexpr void write_help(P const & parser, Destination && destination, int indentation, help_layout const & layout)
+    {
+        auto && sink = sink_for(destination);
+        detail::write_parser_help(sink, parser, indentation, layout);
+    }
+
+    template <typename P, typename Destination>
+    constexpr void write_help_summary(P const & parser, Destination && destination, int indentation, help_layout const & layout)
+    {
+        auto && sink = sink_for(destination);
+        help_layout summary_layout = layout;
+        summary_layout.values = false;
+
+        if constexpr (detail::with_commands<P>)
+            detail::commands_of(parser).write_help(sink, indentation, summary_layout);
+        else
+            detail::write_parser_help(sink, parser, indentation, summary_layout);
+    }
+
+    template <typename P>
+    std::optional<std::string> help_for(P const & parser, std::string_view command_name)
+    {
+        if constexpr (detail::with_commands<P>)
+            return detail::commands_of(parser).help_for(command_name);
+        else
+            return std::nullopt;
+    }
+
+    namespace detail
+    {
+        // Inserts in the index an entry for each command, option and argument of the parser.
+        template <typename Index>
+        struct help_indexer : parser_visitor<help_indexer<Index>>
+        {
+            template <typename C, typename R>
+            constexpr void visit_command(C const & c, R result)
+            {
+                if constexpr (NamedCommand<C>)
+                {
+                    std::string_view description;
+                    if constexpr (requires { {c.description} -> std::convertible_to<std::string_view>; })
+                        description = c.description;
+
+                    index.insert(help_entry{help_entry_kind::command, c.name, description, command});
+
+                    if constexpr (requires { c.parser; })
+                    {
+                        std::string_view const parent = std::exchange(command, c.name);
+                        visit_parser(c.parser, result, *this);
+                        command = parent;
+                    }
+                }
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_option(P const & option, R)
+            {
+                help_entry entry;
+                entry.kind = help_entry_kind::option;
+                entry.command = command;
+                if constexpr (HasDescription<P>)
+                    entry.description = option.description;
+
+                option.for_each_pattern([&](std::string_view pattern) { if (entry.name.empty()) entry.name = pattern; });
+                index.insert(entry);
+                option.for_each_pattern([&](std::string_view pattern) { if (pattern.data() != entry.name.data()) index.add_name(pattern); });
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_argument(P const & argument, R)
+            {
+                help_entry entry;
+                entry.kind = help_entry_kind::argument;
+                entry.command = command;
+                if constexpr (HasDescription<P>)
+                    entry.description = argument.description;
+                entry.name = argument.name;
+                index.insert(entry);
+            }
+
+            Index & index;
+            std::string_view command;
+        };
+
+        template <typename P, typename Index>
+        constexpr void index_help(P const & parser, Index & index, std::string_view command)
+        {
+            help_indexer<Index> indexer{{}, index, command};
+            visit_parser(parser, no_result(), indexer);
+        }
+    }
+
+    template <typename P>
+    constexpr help_index_size measure_help_index(P const & parser) noexcept
+    {
+        help_index_size size;
+        detail::index_help(parser, size, std::string_view());
+        return size;
+    }
+
+    template <size_t EntryCapacity, size_t PostingCapacity, typename P>
+    constexpr help_index<EntryCapacity, PostingCapacity> make_help_index(P const & parser) noexcept
+    {
+        help_index<EntryCapacity, PostingCapacity> index;
+        detail::index_help(parser, index, std::string_view());
+        index.finish();
+        return index;
+    }
+
+    namespace detail
+    {
+        // Inserts in the index the commands and option patterns of the parser that can be written in the context, and the commands
+        // and options that follow each command in contexts of their own.
+        template <typename Index>
+        struct completion_indexer : parser_visitor<completion_indexer<Index>>
+        {
+            template <typename C, typename R>
+            constexpr void visit_command(C const & c, R result)
+            {
+                if constexpr (NamedCommand<C>)
+                {
+                    completion_candidate candidate{completion_kind::command, c.name, {}, {}};
+                    if constexpr (requires { {c.description} -> std::convertible_to<std::string_view>; })
+                        candidate.description = c.description;
+
+                    if constexpr (requires { c.parser; })
+                    {
+                        uint32_t const command_context = index.add_context();
+                        index.insert(context, candidate, command_context);
+                        uint32_t const parent = std::exchange(context, command_context);
+                        visit_parser(c.parser, result, *this);
+                        context = parent;
+                    }
+                    else
+                    {
+                        index.insert(context, candidate);
+                    }
+                }
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_option(P const & option, R)
+            {
+                uint32_t values_context = no_completion_context;
+                uint32_t value_provider = no_value_provider;
+                auto const add_values = [&](std::span<std::string_view const> values)
+                {
+                    values_context = index.add_context();
+                    for (std::string_view const value : values)
+                        index.insert(values_context, completion_candidate{completion_kind::value, value, {}, {}});
+                };
+
+                if constexpr (HasCompletionProvider<P>)
+                {
+                    if constexpr (DynamicCompletionProvider<decltype(option.completion_provider)>)
+                        value_provider = index.add_value_provider(option.completion_provider);
+                    else
+                        add_values(option.completion_provider.values);
+                }
+                else if constexpr (requires { typename P::value_type; requires TraitWithValues<typename P::value_type>; })
+                {
+                    add_values(parse_traits<typename P::value_type>::values);
+                }
+
+                completion_candidate candidate{completion_kind::option, {}, {}, {}};
+                if constexpr (HasDescription<P>)
+                    candidate.description = option.description;
+
+                option.for_each_pattern([&](std::string_view pattern)
+                {
+                    candidate.text = pattern;
+                    index.insert(context, candidate, values_context, value_provider);
+                });
+            }
+
+            Index & index;
+            uint32_t context;
+        };
+
+        template <typename P, typename Index>
+        constexpr void index_completions(P const & parser, Index & index, uint32_t context)
+        {
+            completion_indexer<Index> indexer{{}, index, context};
+            visit_parser(parser, no_result(), indexer);
+        }
+    }
+
+    template <typename P>
+    constexpr completion_index_size measure_completion_index(P const & parser) noexcept
+    {
+        completion_index_size size;
+        detail::index_completions(parser, size, 0);
+        return size;
+    }
+
+    template <size_t NodeCapacity, size_t CandidateCapacity, typename P>
+    constexpr completion_index<NodeCapacity, CandidateCapacity> make_completion_index(P const & parser) noexcept
+    {
+        completion_index<NodeCapacity, CandidateCapacity> index;
+        detail::index_completions(parser, index, 0);
+        return index;
+    }
+
+    namespace detail
+    {
+        // Stands in for a completion index in index_completions to call the value provider with the given number.
+        struct value_provider_caller
+        {
+            constexpr uint32_t add_context() noexcept { return 0; }
+            constexpr void insert(uint32_t, completion_candidate const &, uint32_t = no_completion_context, uint32_t = no_value_provider) noexcept {}
+
+            template <DynamicCompletionProvider Provider>
+            uint32_t add_value_provider(Provider const & provider)
+            {
+                if (count == target)
+                    provider(value, candidates);
+                return count++;
+            }
+
+            uint32_t target;
+            std::string_view value;
+            std::vector<std::string> & candidates;
+            uint32_t count = 0;
+        };
+    }
+
+    template <typename P, size_t NodeCapacity, size_t CandidateCapacity, typename Destination>
+    bool answer_completion_request(P const & parser, completion_index<NodeCapacity, CandidateCapacity> const & completions, ArgsView args, Destination && destination)
+    {
+        std::optional<detail::completion_words> const request = detail::split_completion_request(args);
+        if (!request)
+            return false;
+
+        auto && sink = sink_for(destination);
+        detail::write_completions(completions, *request, sink);
+
+        if (request->writing_program_name())
+            return true;
+
+        if (std::optional<value_provider_request> const provider = completions.find_value_provider(request->preceding(), request->current()))
+        {
+            std::vector<std::string> candidates;
+            detail::value_provider_caller caller{provider->provider, provider->value, candidates};
+            detail::index_completions(parser, caller, 0);
+
+            std::sort(candidates.begin(), candidates.end());
+            for (std::string const & candidate : candidates)
+            {
+                if (candidate.starts_with(provider->value))
+                {
+                    write_completion(sink, completion_candidate{completion_kind::value, candidate, {}, provider->option});
+                    sink.write("\n");
+                }
+            }
+        }
+        return true;
+    }
+
+    template <typename P>
+    constexpr help_layout measure_help_layout(P const & parser, int indentation)
+    {
+        detail::layout_measuring_sink sink;
+        detail::write_parser_help(sink, parser, indentation, help_layout());
+        return sink.layout;
+    }
+
+    constexpr help_layout help_layout::wrapped_to(size_t width_) const noexcept
+    {
+        help_layout wrapped = *this;
+        wrapped.width = width_;
+        if (width_ > 0)
+        {
+            // Descriptions get at least half of the width. Text to the left that does not fit makes the description start in the next line.
+            wrapped.option_column = std::min(option_column, width_ / 2);
+            wrapped.command_column = std::min(command_column, width_ / 2);
+        }
+        return wrapped;
+    }
+
+    template <typename P>
+    std::string_view help_cache<P>::text(size_t width)
+    {
+        auto const found = laid_out_text.find(width);
+        if (found != laid_out_text.end())
+            return found->second;
+
+        std::string & text = laid_out_text[width];
+        write_help(parser, text, 0, columns.wrapped_to(width));
+        return text;
+    }
+
+    template <typename P>
+    constexpr size_t help_size(P const & parser, int indentation)
+    {
+        counting_sink sink;
+        parser.write_help(sink, indentation);
+        return sink.size;
+    }
+
+    template <size_t Size, typename P>
+    constexpr static_text<Size> make_static_help(P const & parser, int indentation)
+    {
+        static_text<Size> help;
+        parser.write_help(help, indentation);
+        return help;
+    }
+
+    //*****************************************************************************************************************************************************
+    // Environment
+
+    namespace detail
+    {
+        // Calls f with the name of the environment variable of each option of the parser that has one.
+        template <typename F>
+        struct environment_variable_visitor : parser_visitor<environment_variable_visitor<F>>
+        {
+            template <typename P, typename R>
+            constexpr void visit_option(P const & option, R)
+            {
+                if constexpr (HasEnvironmentVariable<P>)
+                    f(std::string_view(option.environment_variable));
+            }
+
+            F & f;
+        };
+
+        template <typename P, typename F>
+        constexpr void for_each_environment_variable(P const & parser, F && f)
+        {
+            environment_variable_visitor<std::remove_reference_t<F>> visitor{{}, f};
+            visit_parser(parser, no_result(), visitor);
+        }
+    }
+
+    template <typename P>
+    constexpr size_t environment_variable_count(P const & parser) noexcept
+    {
+        size_t count = 0;
+        detail::for_each_environment_variable(parser, [&count](std::string_view) { ++count; });
+        return count;
+    }
+
+    template <size_t Capacity, typename P>
+    constexpr environment_index<Capacity> make_environment_index(P const & parser) noexcept
+    {
+        std::string_view names[Capacity > 0 ? Capacity : 1] = {};
+        size_t count = 0;
+        detail::for_each_environment_variable(parser, [&](std::string_view name) { names[count++] = name; });
+        return environment_index<Capacity>(std::span(names, count));
+    }
+
+    //*****************************************************************************************************************************************************
+    // Profiles
+
+    namespace detail
+    {
+        // Whether the text of a value in a profile converts to T. Numbers are checked here, since their parse traits are not constexpr,
+        // and other types with their parse traits if they are constexpr. Values of types that can't be checked at compile time are
+        // checked when they are parsed.
+        // Whether text is inf, infinity or nan in any case, or nan followed by letters, digits and underscores in parentheses, which
+        // std::from_chars reads as floating point numbers.
+        constexpr bool is_special_floating_point(std::string_view text) noexcept
+        {
+            auto const starts_with = [text](std::string_view word)
+            {
+                if (text.size() < word.size())
+                    return false;
+                for (size_t i = 0; i < word.size(); ++i)
+                    if (ascii_to_lower(text[i]) != word[i])
+                        return false;
+                return true;
+            };
+
+            if (starts_with("infinity"))
+                return text.size() == 8;
+            if (starts_with("inf"))
+                return text.size() == 3;
+            if (!starts_with("nan"))
+                return false;
+            if (text.size() == 3)
+                return true;
+            if (text[3] != '(' || text.back() != ')')
+                return false;
+            return std::all_of(text.begin() + 4, text.end() - 1, [](char c)
+            {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            });
+        }
+
+        template <typename T>
+        constexpr bool is_valid_profile_value(std::string_view text) noexcept
+        {
+            if constexpr (std::is_same_v<T, bool>)
+            {
+                return text == "true" || text == "false";
+            }
+            else if constexpr (std::is_integral_v<T>)
+            {
+                bool const negative = std::is_signed_v<T> && !text.empty() && text[0] == '-';
+                std::string_view const digits = text.substr(negative ? 1 : 0);
+                if (digits.empty())
+                    return false;
+
+                // Accumulated as a negative number for signed types, whose minimum has no positive counterpart.
+                T value = 0;
+                for (char const c : digits)
+                {
+                    if (c < '0' || c > '9')
+                        return false;
+                    T const digit = T(c - '0');
+                    if (negative ? value < (std::numeric_limits<T>::min() + digit) / 10 : value > (std::numeric_limits<T>::max() - digit) / 10)
+                        return false;
+                    value = negative ? T(value * 10 - digit) : T(value * 10 + digit);
+                }
+                return true;
+            }
+            else if constexpr (std::is_floating_point_v<T>)
+            {
+                // The syntax of std::from_chars: a minus sign, then a number with an optional exponent or a special value.
+                size_t i = (!text.empty() && text[0] == '-') ? 1 : 0;
+                if (is_special_floating_point(text.substr(i)))
+                    return true;
+
+                size_t digits = 0;
+                for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++digits);
+                if (i < text.size() && text[i] == '.')
+                    for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++digits);
+                if (digits == 0)
+                    return false;
+                if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+                {
+                    ++i;
+                    if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+                        ++i;
+                    size_t const exponent_start = i;
+                    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i);
+                    if (i == exponent_start)
+                        return false;
+                }
+                return i == text.size();
+            }
+            else if constexpr (instantiation_of<T, std::vector>)
+            {
+                size_t index = 0;
+                while (index != std::string_view::npos)
+                {
+                    size_t const end = text.find(' ', index);
+                    if (!is_valid_profile_value<typename T::value_type>(text.substr(index, end - index)))
+                        return false;
+                    index = text.find_first_not_of(' ', end);
+                }
+                return true;
+            }
+            else if constexpr (requires { typename std::bool_constant<(parse_traits<T>::parse(std::string_view()), true)>; })
+            {
+                return parse_traits<T>::parse(text).has_value();
+            }
+            else
+            {
+                return true;
+            }
+        }
+
+        // Calls f with each parser of options in the parser.
+        template <typename F>
+        struct options_visitor : parser_visitor<options_visitor<F>>
+        {
+            template <typename P, typename R>
+            constexpr void visit_options(P const & options, R) { f(options); }
+
+            F & f;
+        };
+
+        template <typename P, typename F>
+        constexpr void for_each_parser_of_options(P const & parser, F && f)
+        {
+            options_visitor<std::remove_reference_t<F>> visitor{{}, f};
+            visit_parser(parser, no_result(), visitor);
+        }
+
+        // Checks the values of the profiles of the option against the options of the parser of options it belongs to.
+        template <typename Options, typename Option>
+        constexpr std::string_view profile_error(Options const & options, Option const & profile_option) noexcept
+        {
+            for (size_t i = 0; i < std::size(profile_option.profile_ranges); ++i)
+                for (size_t j = 0; j < i; ++j)
+                    if (profile_option.profile_ranges[i].name == profile_option.profile_ranges[j].name)
+                        return "Two profiles have the same name";
+
+            for (auto const & p : profile_option.profile_ranges)
+            {
+                for (size_t i = p.first; i < p.first + p.count; ++i)
+                {
+                    profile_value const & value = profile_option.profile_values[i];
+                    if (i > p.first && profile_option.profile_values[i - 1].key == value.key)
+                        return "A profile sets the same option twice";
+
+                    bool found = false;
+                    bool valid = true;
+                    bool sets_profile_option = false;
+                    options.for_each_option([&]<typename O>(O const & option)
+                    {
+                        option.for_each_pattern([&](std::string_view pattern)
+                        {
+                            if (found || pattern.substr(std::min(pattern.find_first_not_of('-'), pattern.size())) != value.key)
+                                return;
+                            found = true;
+                            valid = is_valid_profile_value<typename O::value_type>(value.value);
+                            sets_profile_option = HasProfiles<O>;
+                        });
+                    });
+
+                    if (!found)
+                        return "A profile sets an option that is not in the parser of options of the profile option";
+                    if (sets_profile_option)
+                        return "A profile sets the option that chooses profiles";
+                    if (!valid)
+                        return "A profile sets an option to a value that does not convert to its type";
+                }
+            }
+
+            return {};
+        }
+    }
+
+    template <typename P>
+    constexpr std::string_view profile_error(P const & parser) noexcept
+    {
+        std::string_view error;
+        auto const check_options = [&error](auto const & options)
+        {
+            options.for_each_option([&]<typename O>(O const & option)
+            {
+                if constexpr (HasProfiles<O>)
+                    if (error.empty())
+                        error = detail::profile_error(options, option);
+            });
+        };
+
+        // Profiles are applied to the parser of options their option is in, so they are checked against it.
+        detail::for_each_parser_of_options(parser, check_options);
+        return error;
+    }
+
+    //*****************************************************************************************************************************************************
+    // Schema
+
+    namespace detail
+    {
+        template <typename O, typename W>
+        constexpr void write_schema_values(O const & option, W & writer)
+        {
+            if constexpr (HasDescription<O>)
+                writer.string("description", option.description);
+
+            if constexpr (HasDefaultValue<O>)
+                writer.value("default", option.default_value);
+
+            if constexpr (HasLazyDefaultValue<O>)
+                writer.boolean("computed_default", true);
+
+            if constexpr (HasImplicitValue<O>)
+                writer.value("implicit", option.implicit_value);
+
+            if constexpr (HasProfiles<O>)
+            {
+                writer.begin_array("profiles");
+                for (auto const & p : option.profile_ranges)
+                {
+                    writer.begin_object({});
+                    writer.string("name", p.name);
+                    writer.begin_object("values");
+                    for (size_t i = p.first; i < p.first + p.count; ++i)
+                        writer.string(option.profile_values[i].key, option.profile_values[i].value);
+                    writer.end_object();
+                    writer.end_object();
+                }
+                writer.end_array();
+            }
+
+            if constexpr (requires { option.for_each_check_message([](std::string_view) {}); })
+            {
+                writer.begin_array("checks");
+                option.for_each_check_message([&writer](std::string_view message) { writer.string({}, message); });
+                writer.end_array();
+            }
+        }
+
+        template <typename O, typename W>
+        constexpr void write_schema_option(O const & option, W & writer)
+        {
+            writer.begin_object({});
+            writer.begin_array("patterns");
+            option.for_each_pattern([&writer](std::string_view pattern) { writer.string({}, pattern); });
+            writer.end_array();
+            writer.string("hint", option.hint_text());
+            if constexpr (HasEnvironmentVariable<O>)
+                writer.string("environment", option.environment_variable);
+            write_schema_values(option, writer);
+            writer.end_object();
+        }
+
+        template <typename A, typename W>
+        constexpr void write_schema_argument(A const & argument, W & writer)
+        {
+            writer.begin_object({});
+            writer.string("name", argument.name);
+            writer.string("hint", argument.hint_text());
+            write_schema_values(argument, writer);
+            writer.end_object();
+        }
+
+        // Writes the fields of the object that describes the parser.
+        template <typename W>
+        struct schema_visitor : parser_visitor<schema_visitor<W>>
+        {
+            template <typename P, typename R>
+            constexpr void visit_abbreviated(P const & parser, R result)
+            {
+                writer.boolean("abbreviations", true);
+                visit_parser(parser, result, *this);
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_commands(P const & commands, R result)
+            {
+                writer.begin_array("commands");
+                parser_visitor<schema_visitor>::visit_commands(commands, result);
+                writer.end_array();
+            }
+
+            template <typename C, typename R>
+            constexpr void visit_command(C const & c, R result)
+            {
+                writer.begin_object({});
+                if constexpr (NamedCommand<C>)
+                    writer.string("name", c.name);
+                if constexpr (requires { {c.description} -> std::convertible_to<std::string_view>; })
+                    writer.string("description", c.description);
+                if constexpr (requires { c.parser; })
+                {
+                    writer.begin_object("parser");
+                    visit_parser(c.parser, result, *this);
+                    writer.end_object();
+                }
+                writer.end_object();
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_options(P const & options, R)
+            {
+                writer.begin_array("options");
+                options.for_each_option([this](auto const & option) { write_schema_option(option, writer); });
+                writer.end_array();
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_arguments(P const & arguments, R)
+            {
+                writer.begin_array("arguments");
+                arguments.for_each_argument([this](auto const & argument) { write_schema_argument(argument, writer); });
+                writer.end_array();
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_multicall(P const & parser, R result)
+            {
+                writer.string("program", parser.program_name);
+                visit_parser(parser.commands, result, *this);
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_implicit_command(P const & parser, R result)
+            {
+                visit_parser(parser.commands, result, *this);
+                writer.begin_object("implicit_command");
+                visit_parser(parser.implicit_command, result, *this);
+                writer.end_object();
+            }
+
+            // Parsers of a single option or argument.
+            template <typename P, typename R>
+            constexpr void visit_option(P const & option, R)
+            {
+                writer.begin_array("options");
+                write_schema_option(option, writer);
+                writer.end_array();
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_argument(P const & argument, R)
+            {
+                writer.begin_array("arguments");
+                write_schema_argument(argument, writer);
+                writer.end_array();
+            }
+
+            W & writer;
+        };
+
+        template <typename P, typename W>
+        constexpr void write_schema_fields(P const & parser, W & writer)
+        {
+            schema_visitor<W> visitor{{}, writer};
+            visit_parser(parser, no_result(), visitor);
+        }
+
+        template <typename P, Sink S>
+        constexpr void write_schema_to(P const & parser, S & sink, schema_format format)
+        {
+            auto const write = [&parser](auto writer)
+            {
+                writer.begin_object({});
+                write_schema_fields(parser, writer);
+                writer.end_object();
+            };
+
+            if (format == schema_format::json)
+                write(json_schema_writer<S>(sink));
+            else
+                write(cbor_schema_writer<S>(sink));
+        }
+    }
+
+    template <typename P, typename Destination>
+    constexpr void write_schema(P const & parser, Destination && destination, schema_format format)
+    {
+        auto && sink = sink_for(destination);
+        detail::write_schema_to(parser, sink, format);
+    }
+
+    template <typename P>
+    constexpr size_t schema_size(P const & parser, schema_format format)
+    {
+        counting_sink sink;
+        detail::write_schema_to(parser, sink, format);
+        return sink.size;
+    }
+
+    template <size_t Size, typename P>
+    constexpr static_text<Size> make_static_schema(P const & parser, schema_format format)
+    {
+        static_text<Size> schema;
+        detail::write_schema_to(parser, schema, format);
+        return schema;
+    }
+
+    template <typename P>
+    constexpr uint64_t parser_fingerprint(P const & parser)
+    {
+        hashing_sink sink;
+        detail::write_schema_to(parser, sink, schema_format::json);
+        detail::write_integer(sink, sizeof(typename P::parse_result_type));
+        return sink.hash;
+    }
+
+    template <typename P>
+    constexpr uint64_t parser_fingerprint(P const & parser, std::string_view build_id)
+    {
+        hashing_sink sink;
+        detail::write_integer(sink, parser_fingerprint(parser));
+        sink.write(build_id);
+        return sink.hash;
+    }
+
+    //*****************************************************************************************************************************************************
+    // Footprint
+
+    namespace detail
+    {
+        // Adds the options, patterns, arguments and commands of the parser to the footprint. Each member returns the most probes a token
+        // takes in the parser it visits.
+        struct footprint_counter : parser_visitor<footprint_counter>
+        {
+            template <typename P, typename R>
+            constexpr size_t visit_commands(P const & commands, R result)
+            {
+                size_t probes = P::command_count;
+                footprint.commands += P::command_count;
+                commands.for_each_command([&](auto const & c)
+                {
+                    if constexpr (requires { c.parser; })
+                        probes = std::max(probes, visit_parser(c.parser, result, *this));
+                });
+                return probes;
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_options(P const & options, R result)
+            {
+                size_t probes = 0;
+                options.for_each_option([&](auto const & option) { probes += visit_parser(option, result, *this); });
+                return probes;
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_arguments(P const & arguments, R result)
+            {
+                arguments.for_each_argument([&](auto const & argument) { visit_parser(argument, result, *this); });
+                return 0;
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_compound(P const & parser, R result)
+            {
+                visit_parser(parser.access_arguments(), result, *this);
+                return visit_parser(parser.access_options(), result, *this);
+            }
+
+            // The tool is found in a perfect hash, and its arguments are parsed by the parser of the command.
+            template <typename P, typename R>
+            constexpr size_t visit_multicall(P const & parser, R result)
+            {
+                size_t probes = 1;
+                footprint.commands += std::remove_cvref_t<decltype(parser.commands)>::command_count;
+                parser.commands.for_each_command([&](auto const & c)
+                {
+                    if constexpr (requires { c.parser; })
+                        probes = std::max(probes, visit_parser(c.parser, result, *this));
+                });
+                return probes;
+            }
+
+            // Tokens before the command are compared with every command name before they are parsed by the other parser.
+            template <typename P, typename R>
+            constexpr size_t visit_shared_options(P const & parser, R result)
+            {
+                size_t const probes = visit_parser(parser.commands, result, *this);
+                return std::max(probes, std::remove_cvref_t<decltype(parser.commands)>::command_count + visit_parser(parser.shared_options, result, *this));
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_implicit_command(P const & parser, R result)
+            {
+                size_t const probes = visit_parser(parser.commands, result, *this);
+                return std::max(probes, std::remove_cvref_t<decltype(parser.commands)>::command_count + visit_parser(parser.implicit_command, result, *this));
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_option(P const & option, R)
+            {
+                size_t patterns = 0;
+                option.for_each_pattern([&](std::string_view) { ++patterns; });
+                ++footprint.options;
+                footprint.patterns += patterns;
+                return patterns;
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_argument(P const &, R)
+            {
+                ++footprint.arguments;
+                return 0;
+            }
+
+            template <typename P, typename R>
+            constexpr size_t visit_other(P const &, R) { return 0; }
+
+            parser_footprint & footprint;
+        };
+
+        template <typename P>
+        constexpr size_t count_footprint(P const & parser, parser_footprint & footprint) noexcept
+        {
+            footprint_counter counter{{}, footprint};
+            return visit_parser(parser, no_result(), counter);
+        }
+    }
+
+    template <typename P>
+    constexpr parser_footprint measure_footprint(P const & parser) noexcept
+    {
+        parser_footprint footprint;
+        footprint.parser_size = sizeof(P);
+        footprint.result_size = sizeof(typename P::parse_result_type);
+        footprint.max_probes_per_token = detail::count_footprint(parser, footprint);
+        return footprint;
+    }
+
     template <typename T, size_t N>
     struct parse_traits<dodo::constant_range<T, N>>
     {
@@ -754,6 +2625,17 @@ namespace dodo
 
             return result;
         }
+
+        template <Sink S>
+        static constexpr void write(S & sink, dodo::constant_range<T, N> const & r)
+        {
+            for (size_t i = 0; i < N; ++i)
+            {
+                if (i > 0)
+                    sink.write(" ");
+                write_value(sink, r.array[i]);
+            }
+        }
     };
 
 } // namespace dodo
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "perfect_hash.hh"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <stdlib.h>
+#else
+extern char ** environ;
+#endif
+
+namespace dodo
+{
+
+    namespace detail
+    {
+        // Environment of the process, as a null terminated array of "NAME=value" strings.
+        inline char const * const * process_environment() noexcept
+        {
+        #if defined(_WIN32)
+            char ** entries = nullptr;
+            ::_get_environ(&entries);
+            return entries;
+        #else
+            return environ;
+        #endif
+        }
+
+        // Splits a "NAME=value" entry of the environment. Entries with no '=' have no value.
+        constexpr std::optional<std::pair<std::string_view, std::string_view>> split_environment_entry(std::string_view entry) noexcept
+        {
+            // On Windows, variables that hold the working directory of each drive are named "=C:", so the name can't start the search.
+            size_t const equals = entry.find('=', 1);
+            if (equals == std::string_view::npos)
+                return std::nullopt;
+            return std::pair(entry.substr(0, equals), entry.substr(equals + 1));
+        }
+
+        // Values of the given variables in the environment of the process, found with one pass over it.
+        inline std::vector<std::optional<std::string_view>> find_in_process_environment(std::span<std::string_view const> names)
+        {
+            std::unordered_map<std::string_view, size_t> slots;
+            for (size_t i = 0; i < names.size(); ++i)
+                slots.emplace(names[i], i);
+
+            std::vector<std::optional<std::string_view>> values(names.size());
+            if (char const * const * entries = process_environment())
+                for (; *entries != nullptr; ++entries)
+                    if (auto const variable = split_environment_entry(*entries))
+                        if (auto const slot = slots.find(variable->first); slot != slots.end())
+                            values[slot->second] = variable->second;
+
+            // Repeated names take the value of the first.
+            for (size_t i = 0; i < names.size(); ++i)
+                values[i] = values[slots.find(names[i])->second];
+            return values;
+        }
+    }
+
+    template <size_t Capacity>
+    struct environment_values;
+
+    // Perfect hash of the names of the environment variables that the options of a parser read, which dodo_EnvironmentIndex(cli) builds
+    // at compile time. Finding the values of all of them takes one pass over the environment, with one lookup per variable in it.
+    template <size_t Capacity>
+    struct environment_index
+    {
+        constexpr explicit environment_index(std::span<std::string_view const> names) noexcept
+            : variables(names, slots(names.size()))
+        {}
+
+        // Values in the environment of the process.
+        environment_values<Capacity> scan() const noexcept
+        {
+            environment_values<Capacity> values(*this);
+            if (char const * const * entries = detail::process_environment())
+                for (; *entries != nullptr; ++entries)
+                    values.add(*entries);
+            return values;
+        }
+
+        // Values in the given environment, as "NAME=value" strings.
+        constexpr environment_values<Capacity> scan(std::span<char const * const> entries) const noexcept
+        {
+            environment_values<Capacity> values(*this);
+            for (char const * const entry : entries)
+                values.add(entry);
+            return values;
+        }
+
+        perfect_hash<Capacity> variables;
+
+    private:
+        struct slot_numbers
+        {
+            uint32_t numbers[Capacity > 0 ? Capacity : 1] = {};
+            size_t count = 0;
+
+            constexpr operator std::span<uint32_t const>() const noexcept { return std::span(numbers, count); }
+        };
+
+        static constexpr slot_numbers slots(size_t count) noexcept
+        {
+            slot_numbers s;
+            for (s.count = 0; s.count < count; ++s.count)
+                s.numbers[s.count] = uint32_t(s.count);
+            return s;
+        }
+    };
+
+    // Values of the variables of an environment_index, which point into the environment they were found in.
+    template <size_t Capacity>
+    struct environment_values
+    {
+        constexpr explicit environment_values(environment_index<Capacity> const & index_) noexcept : index(&index_) {}
+
+        constexpr std::optional<std::string_view> find(std::string_view name) const noexcept
+        {
+            if (std::optional<uint32_t> const slot = index->variables.find(name))
+                return values[*slot];
+            return std::nullopt;
+        }
+
+        constexpr void add(std::string_view entry) noexcept
+        {
+            if (auto const variable = detail::split_environment_entry(entry))
+                if (std::optional<uint32_t> const slot = index->variables.find(variable->first))
+                    values[*slot] = variable->second;
+        }
+
+    private:
+        environment_index<Capacity> const * index;
+        std::optional<std::string_view> values[Capacity > 0 ? Capacity : 1] = {};
+    };
+
+    // How options find the values of their environment variables while parsing. By default, each group of options finds the values of
+    // the variables it reads with one scan of the environment of the process per parse. Found beforehand in environment_values, they
+    // take a lookup each.
+    struct environment_lookup
+    {
+        constexpr environment_lookup() noexcept = default;
+
+        template <size_t Capacity>
+        constexpr environment_lookup(environment_values<Capacity> const & values_) noexcept
+            : values(&values_)
+            , find_in_values([](void const * source, std::string_view name) { return static_cast<environment_values<Capacity> const *>(source)->find(name); })
+        {}
+
+        // Whether values are found in environment_values instead of in the environment of the process.
+        constexpr bool is_indexed() const noexcept { return find_in_values != nullptr; }
+
+        // Looking up a variable that is not indexed takes a pass over the environment of the process.
+        std::optional<std::string_view> find(std::string_view name) const noexcept
+        {
+            if (find_in_values != nullptr)
+                return find_in_values(values, name);
+
+            if (char const * const * entries = detail::process_environment())
+                for (; *entries != nullptr; ++entries)
+                    if (auto const variable = detail::split_environment_entry(*entries); variable && variable->first == name)
+                        return variable->second;
+            return std::nullopt;
+        }
+
+    private:
+        void const * values = nullptr;
+        std::optional<std::string_view> (*find_in_values)(void const * source, std::string_view name) = nullptr;
+    };
+
+} // namespace dodo
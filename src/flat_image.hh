@@ -0,0 +1,547 @@
+#pragma once
+
+#include "dodo.hh"
+#include "platform.hh"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dodo
+{
+
+    // Where a value is in a flat image, as an offset from the start of the image. size is the number of elements of strings and
+    // arrays, and 1 for single values. Values of options that were not parsed, such as those of commands that were not chosen, are not
+    // present.
+    struct flat_slot
+    {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+        uint32_t present = 0;
+    };
+
+    // Range of the strings of an array in a flat image.
+    struct flat_strings
+    {
+        struct iterator
+        {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+
+            std::string_view operator * () const noexcept { return std::string_view(image + slot->offset, slot->size); }
+            iterator & operator ++ () noexcept { ++slot; return *this; }
+            iterator operator ++ (int) noexcept { iterator const old = *this; ++slot; return old; }
+            bool operator == (iterator const &) const noexcept = default;
+
+            char const * image = nullptr;
+            flat_slot const * slot = nullptr;
+        };
+
+        size_t size() const noexcept { return slots.size(); }
+        bool empty() const noexcept { return slots.empty(); }
+        std::string_view operator [] (size_t i) const noexcept { return std::string_view(image + slots[i].offset, slots[i].size); }
+        iterator begin() const noexcept { return iterator{image, slots.data()}; }
+        iterator end() const noexcept { return iterator{image, slots.data() + slots.size()}; }
+
+        char const * image = nullptr;
+        std::span<flat_slot const> slots;
+    };
+
+    // Bytes of a flat image being written. Values are aligned from the start of the image, which is page aligned when it is mapped.
+    struct flat_image_writer
+    {
+        uint64_t append(void const * data, size_t size, size_t alignment)
+        {
+            bytes.resize((bytes.size() + alignment - 1) / alignment * alignment);
+            uint64_t const offset = bytes.size();
+            bytes.append(static_cast<char const *>(data), size);
+            return offset;
+        }
+
+        std::string bytes;
+    };
+
+    // How values of type T are stored in a flat image, and the type they are read as, which points into the image. write appends the
+    // value and returns its slot, check says whether a slot of the image holds a well formed value of the type, and read reads a slot
+    // that passed check. Numbers and enums are read as themselves, strings as string views, vectors of numbers as spans, vectors of
+    // strings as flat_strings and optionals as optionals of what their value is read as.
+    template <typename T>
+    struct flat_traits;
+
+    template <typename T>
+    concept TraitFlat = requires { typename flat_traits<T>::view_type; };
+
+    namespace detail
+    {
+        template <typename T>
+        bool is_flat_range(std::span<char const> image, flat_slot slot) noexcept
+        {
+            return slot.offset <= image.size()
+                && uint64_t(slot.size) * sizeof(T) <= image.size() - slot.offset
+                && reinterpret_cast<uintptr_t>(image.data() + slot.offset) % alignof(T) == 0;
+        }
+
+        template <typename T>
+        concept flat_scalar = std::is_arithmetic_v<T> || std::is_enum_v<T>;
+
+        template <typename T>
+        concept flat_string = std::same_as<T, std::string> || std::same_as<T, std::string_view>;
+
+        // Whether the bytes of a slot are a value of the type, which is read from them without constructing one. Every bit pattern is
+        // a number, but only 0 and 1 are bools, and only the values of their enumerators are enums. Enums whose parse traits don't list
+        // their enumerators are trusted, which is only safe for enums with a fixed underlying type.
+        template <flat_scalar T>
+        bool is_flat_scalar_value(char const * bytes) noexcept
+        {
+            if constexpr (std::same_as<T, bool>)
+            {
+                return uint8_t(bytes[0]) <= 1;
+            }
+            else if constexpr (std::is_enum_v<T> && TraitWithValues<T>)
+            {
+                std::underlying_type_t<T> value;
+                std::memcpy(&value, bytes, sizeof(value));
+                for (std::string_view const name : parse_traits<T>::values)
+                    if (std::optional<T> const enumerator = parse_traits<T>::parse(name); enumerator && std::underlying_type_t<T>(*enumerator) == value)
+                        return true;
+                return false;
+            }
+            else
+            {
+                return true;
+            }
+        }
+    }
+
+    template <detail::flat_scalar T>
+    struct flat_traits<T>
+    {
+        using view_type = T;
+
+        static flat_slot write(flat_image_writer & writer, T value) { return flat_slot{writer.append(&value, sizeof(T), alignof(T)), 1, 1}; }
+        static bool check(std::span<char const> image, flat_slot slot) noexcept
+        {
+            return slot.size == 1 && detail::is_flat_range<T>(image, slot) && detail::is_flat_scalar_value<T>(image.data() + slot.offset);
+        }
+
+        static T read(char const * image, flat_slot slot) noexcept
+        {
+            T value;
+            std::memcpy(&value, image + slot.offset, sizeof(T));
+            return value;
+        }
+    };
+
+    template <detail::flat_string T>
+    struct flat_traits<T>
+    {
+        using view_type = std::string_view;
+
+        static flat_slot write(flat_image_writer & writer, std::string_view value) { return flat_slot{writer.append(value.data(), value.size(), 1), uint32_t(value.size()), 1}; }
+        static bool check(std::span<char const> image, flat_slot slot) noexcept { return detail::is_flat_range<char>(image, slot); }
+        static std::string_view read(char const * image, flat_slot slot) noexcept { return std::string_view(image + slot.offset, slot.size); }
+    };
+
+    // vector<bool> has no contiguous elements to point to.
+    template <detail::flat_scalar T, typename Alloc> requires(!std::same_as<T, bool>)
+    struct flat_traits<std::vector<T, Alloc>>
+    {
+        using view_type = std::span<T const>;
+
+        static flat_slot write(flat_image_writer & writer, std::vector<T, Alloc> const & value)
+        {
+            return flat_slot{writer.append(value.data(), value.size() * sizeof(T), alignof(T)), uint32_t(value.size()), 1};
+        }
+
+        static bool check(std::span<char const> image, flat_slot slot) noexcept { return detail::is_flat_range<T>(image, slot); }
+
+        static std::span<T const> read(char const * image, flat_slot slot) noexcept
+        {
+            return std::span<T const>(reinterpret_cast<T const *>(image + slot.offset), slot.size);
+        }
+    };
+
+    template <detail::flat_string T, typename Alloc>
+    struct flat_traits<std::vector<T, Alloc>>
+    {
+        using view_type = flat_strings;
+
+        static flat_slot write(flat_image_writer & writer, std::vector<T, Alloc> const & value)
+        {
+            std::vector<flat_slot> strings;
+            strings.reserve(value.size());
+            for (T const & s : value)
+                strings.push_back(flat_traits<T>::write(writer, s));
+            return flat_slot{writer.append(strings.data(), strings.size() * sizeof(flat_slot), alignof(flat_slot)), uint32_t(strings.size()), 1};
+        }
+
+        static bool check(std::span<char const> image, flat_slot slot) noexcept
+        {
+            if (!detail::is_flat_range<flat_slot>(image, slot))
+                return false;
+            for (flat_slot const & s : read(image.data(), slot).slots)
+                if (!flat_traits<T>::check(image, s))
+                    return false;
+            return true;
+        }
+
+        static flat_strings read(char const * image, flat_slot slot) noexcept
+        {
+            return flat_strings{image, std::span<flat_slot const>(reinterpret_cast<flat_slot const *>(image + slot.offset), slot.size)};
+        }
+    };
+
+    // The slot of an optional with a value points to the slot of the value. The slot of an empty optional has size 0.
+    template <TraitFlat T>
+    struct flat_traits<std::optional<T>>
+    {
+        using view_type = std::optional<typename flat_traits<T>::view_type>;
+
+        static flat_slot write(flat_image_writer & writer, std::optional<T> const & value)
+        {
+            if (!value)
+                return flat_slot{0, 0, 1};
+            flat_slot const inner = flat_traits<T>::write(writer, *value);
+            return flat_slot{writer.append(&inner, sizeof(inner), alignof(flat_slot)), 1, 1};
+        }
+
+        static bool check(std::span<char const> image, flat_slot slot) noexcept
+        {
+            if (slot.size == 0)
+                return true;
+            return slot.size == 1 && detail::is_flat_range<flat_slot>(image, slot) && flat_traits<T>::check(image, inner(image.data(), slot));
+        }
+
+        static view_type read(char const * image, flat_slot slot) noexcept
+        {
+            if (slot.size == 0)
+                return std::nullopt;
+            return flat_traits<T>::read(image, inner(image, slot));
+        }
+
+    private:
+        static flat_slot inner(char const * image, flat_slot slot) noexcept { return *reinterpret_cast<flat_slot const *>(image + slot.offset); }
+    };
+
+    namespace detail
+    {
+        // Calls f with each option and argument of the parser and a pointer to its value in the result, which is null for the options
+        // of commands that were not chosen. With a null result, f is called with every option and a null value.
+        template <typename F>
+        struct flat_value_visitor : parser_visitor<flat_value_visitor<F>>
+        {
+            template <typename P, typename R>
+            constexpr void visit_option(P const & option, R result) { visit_value(option, result); }
+
+            template <typename P, typename R>
+            constexpr void visit_argument(P const & argument, R result) { visit_value(argument, result); }
+
+            template <typename P, typename R>
+            constexpr void visit_other(P const &, R)
+            {
+                static_assert(sizeof(P) == 0, "Results of this parser can't be flattened");
+            }
+
+            template <typename P, typename R>
+            constexpr void visit_value(P const & parser, R result)
+            {
+                using value_type = typename P::value_type;
+                static_assert(TraitFlat<value_type>, "Values of this type can't be flattened. Specialize flat_traits for it");
+                f(parser, result != nullptr ? &static_cast<typename P::parse_result_type const &>(*result)._get() : static_cast<value_type const *>(nullptr));
+            }
+
+            F & f;
+        };
+
+        template <typename P, typename Result, typename F>
+        constexpr void for_each_flat_value(P const & parser, Result const * result, F && f)
+        {
+            flat_value_visitor<std::remove_reference_t<F>> visitor{{}, f};
+            visit_parser(parser, result, visitor);
+        }
+
+        // Index of the slot of the option or argument whose values are of the given struct, which dodo_Opt and dodo_Arg make unique
+        // for each option and argument. The first one if the option is in the parser more than once.
+        template <typename OptionStruct, typename P>
+        constexpr size_t flat_slot_index(P const & parser)
+        {
+            size_t index = 0;
+            size_t found = size_t(-1);
+            for_each_flat_value(parser, null_pointer_to<typename P::parse_result_type const>, [&]<typename O, typename V>(O const &, V const *)
+            {
+                if constexpr (std::same_as<typename O::parse_result_type, OptionStruct>)
+                    if (found == size_t(-1))
+                        found = index;
+                ++index;
+            });
+            return found;
+        }
+
+        constexpr std::string_view flat_image_magic = "dodofi01";
+        constexpr size_t flat_image_header_size = 32;
+    }
+
+    // Writes the result as a flat image: a single block of bytes with no pointers, that can be placed anywhere in memory, and that is
+    // read with a flat_result_view with no parsing or copies. The image is:
+    //   header: "dodofi01", fingerprint of the parser, slot count, 4 bytes of padding, size of the image
+    //   slots:  a flat_slot for each option and argument of the parser, in order
+    //   values: the values of the slots, aligned to their types
+    // Numbers are in the byte order of the machine that wrote them, since images are shared between processes of the same program.
+    template <typename P>
+    std::string write_flat_image(P const & parser, typename P::parse_result_type const & result, uint64_t fingerprint)
+    {
+        std::vector<flat_slot> slots;
+        flat_image_writer writer;
+
+        // Slots come before the values, so they are written once the values are.
+        size_t slot_count = 0;
+        detail::for_each_flat_value(parser, detail::null_pointer_to<typename P::parse_result_type const>, [&](auto const &, auto const *) { ++slot_count; });
+        writer.bytes.resize(detail::flat_image_header_size + slot_count * sizeof(flat_slot));
+
+        detail::for_each_flat_value(parser, &result, [&]<typename O, typename V>(O const &, V const * value)
+        {
+            slots.push_back(value != nullptr ? flat_traits<V>::write(writer, *value) : flat_slot());
+        });
+
+        uint32_t const count = uint32_t(slots.size());
+        uint64_t const size = writer.bytes.size();
+        char * const header = writer.bytes.data();
+        std::memcpy(header, detail::flat_image_magic.data(), 8);
+        std::memcpy(header + 8, &fingerprint, sizeof(fingerprint));
+        std::memcpy(header + 16, &count, sizeof(count));
+        std::memcpy(header + 24, &size, sizeof(size));
+        std::memcpy(header + detail::flat_image_header_size, slots.data(), slots.size() * sizeof(flat_slot));
+        return std::move(writer.bytes);
+    }
+
+    template <typename P>
+    std::string write_flat_image(P const & parser, typename P::parse_result_type const & result)
+    {
+        return write_flat_image(parser, result, parser_fingerprint(parser));
+    }
+
+    // Typed read only view of a flat image. Values are read from the image in place, as the view types of their flat_traits, so many
+    // processes can read the same physical pages of a shared image with no copies.
+    template <typename P>
+    struct flat_result_view
+    {
+        // Returns nothing if the bytes are not an image of a result of a parser with the fingerprint. Every slot is checked here, so
+        // that reads can trust them. The bytes must outlive the view.
+        static std::optional<flat_result_view> from_bytes(P const & parser, std::span<char const> bytes, uint64_t fingerprint);
+        static std::optional<flat_result_view> from_bytes(P const & parser, std::span<char const> bytes)
+        {
+            return from_bytes(parser, bytes, parser_fingerprint(parser));
+        }
+
+        // Whether the option or argument was parsed. Options of commands that were not chosen were not, and neither were options that
+        // are not in the parser.
+        template <typename O>
+        bool has(O const &) const noexcept
+        {
+            size_t const index = slot_index<O>();
+            return index < slots.size() && slots[index].present != 0;
+        }
+
+        // Value of the option or argument, which must have been parsed. Throws std::out_of_range if the option is not in the parser.
+        template <typename O>
+        typename flat_traits<typename O::value_type>::view_type get(O const & option) const
+        {
+            size_t const index = slot_index<O>();
+            if (index >= slots.size())
+                throw std::out_of_range("The option is not in the parser of the flat image");
+            assert(has(option));
+            return flat_traits<typename O::value_type>::read(image.data(), slots[index]);
+        }
+
+    private:
+        // The slots of a parser only depend on its type, so the slot of each option is found once per program instead of on every read.
+        template <typename O>
+        size_t slot_index() const noexcept
+        {
+            static size_t const index = detail::flat_slot_index<typename O::parse_result_type>(parser);
+            return index;
+        }
+
+        flat_result_view(P const & parser_, std::span<char const> image_, std::span<flat_slot const> slots_) noexcept
+            : parser(parser_)
+            , image(image_)
+            , slots(slots_)
+        {}
+
+        P parser;
+        std::span<char const> image;
+        std::span<flat_slot const> slots;
+    };
+
+    template <typename P>
+    auto flat_result_view<P>::from_bytes(P const & parser, std::span<char const> bytes, uint64_t fingerprint) -> std::optional<flat_result_view>
+    {
+        if (bytes.size() < detail::flat_image_header_size || std::string_view(bytes.data(), 8) != detail::flat_image_magic)
+            return std::nullopt;
+
+        uint64_t image_fingerprint, size;
+        uint32_t count;
+        std::memcpy(&image_fingerprint, bytes.data() + 8, sizeof(image_fingerprint));
+        std::memcpy(&count, bytes.data() + 16, sizeof(count));
+        std::memcpy(&size, bytes.data() + 24, sizeof(size));
+        if (image_fingerprint != fingerprint || size != bytes.size())
+            return std::nullopt;
+
+        flat_slot const slot_table{detail::flat_image_header_size, count, 1};
+        if (!detail::is_flat_range<flat_slot>(bytes, slot_table))
+            return std::nullopt;
+        std::span<flat_slot const> const slots(reinterpret_cast<flat_slot const *>(bytes.data() + detail::flat_image_header_size), count);
+
+        size_t index = 0;
+        bool valid = true;
+        detail::for_each_flat_value(parser, detail::null_pointer_to<typename P::parse_result_type const>, [&]<typename O, typename V>(O const &, V const *)
+        {
+            if (index >= slots.size())
+                valid = false;
+            else if (slots[index].present != 0 && !flat_traits<V>::check(bytes, slots[index]))
+                valid = false;
+            ++index;
+        });
+        if (!valid || index != slots.size())
+            return std::nullopt;
+
+        return flat_result_view(parser, bytes, slots);
+    }
+
+    // Read only memory that is shared with the processes that are forked after it is created, which see the same physical pages instead
+    // of copies. On Linux it is a sealed memfd, whose descriptor can also be passed to other processes. On other POSIX systems it is a
+    // shared anonymous mapping, and on Windows a section backed by the paging file.
+    struct shared_memory
+    {
+    #if defined(_WIN32)
+        using native_handle_type = detail::win32::handle;
+    #else
+        using native_handle_type = int;
+    #endif
+
+        // Returns nothing if the memory could not be created.
+        static std::optional<shared_memory> create(std::string_view bytes) noexcept;
+
+        shared_memory(shared_memory && other) noexcept;
+        shared_memory & operator = (shared_memory && other) noexcept;
+        ~shared_memory();
+
+        std::span<char const> bytes() const noexcept { return std::span<char const>(data, size); }
+
+        // The memfd on Linux and the section on Windows. -1 on other systems.
+        native_handle_type native_handle() const noexcept { return handle; }
+
+    private:
+        shared_memory() noexcept = default;
+
+        char const * data = nullptr;
+        size_t size = 0;
+    #if defined(_WIN32)
+        detail::win32::handle handle = nullptr;
+    #else
+        int handle = -1;
+    #endif
+    };
+
+    inline shared_memory::shared_memory(shared_memory && other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    // The memory of this is released by the destructor of other.
+    inline shared_memory & shared_memory::operator = (shared_memory && other) noexcept
+    {
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+#if defined(_WIN32)
+    inline std::optional<shared_memory> shared_memory::create(std::string_view bytes) noexcept
+    {
+        using namespace detail::win32;
+        shared_memory memory;
+        uint64_t const size = bytes.size();
+        memory.handle = CreateFileMappingA(invalid_handle_value, nullptr, page_readwrite, dword(size >> 32), dword(size), nullptr);
+        if (memory.handle == nullptr)
+            return std::nullopt;
+
+        void * const writable = MapViewOfFile(memory.handle, file_map_write, 0, 0, bytes.size());
+        if (writable == nullptr)
+            return std::nullopt;
+        std::memcpy(writable, bytes.data(), bytes.size());
+        UnmapViewOfFile(writable);
+
+        memory.data = static_cast<char const *>(MapViewOfFile(memory.handle, file_map_read, 0, 0, bytes.size()));
+        if (memory.data == nullptr)
+            return std::nullopt;
+        memory.size = bytes.size();
+        return memory;
+    }
+
+    inline shared_memory::~shared_memory()
+    {
+        if (data != nullptr)
+            detail::win32::UnmapViewOfFile(data);
+        if (handle != nullptr)
+            detail::win32::CloseHandle(handle);
+    }
+#else
+    inline std::optional<shared_memory> shared_memory::create(std::string_view bytes) noexcept
+    {
+        if (bytes.empty())
+            return std::nullopt;
+
+        shared_memory memory;
+    #if defined(__linux__)
+        memory.handle = ::memfd_create("dodo", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (memory.handle < 0 || ::ftruncate(memory.handle, off_t(bytes.size())) != 0)
+            return std::nullopt;
+
+        void * const writable = ::mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_SHARED, memory.handle, 0);
+        if (writable == MAP_FAILED)
+            return std::nullopt;
+        std::memcpy(writable, bytes.data(), bytes.size());
+        ::munmap(writable, bytes.size());
+
+        // Sealed, so that processes the descriptor is passed to can trust that the contents don't change.
+        if (::fcntl(memory.handle, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0)
+            return std::nullopt;
+        void * const mapping = ::mmap(nullptr, bytes.size(), PROT_READ, MAP_SHARED, memory.handle, 0);
+    #else
+        void * const mapping = ::mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mapping != MAP_FAILED)
+        {
+            std::memcpy(mapping, bytes.data(), bytes.size());
+            ::mprotect(mapping, bytes.size(), PROT_READ);
+        }
+    #endif
+        if (mapping == MAP_FAILED)
+            return std::nullopt;
+
+        memory.data = static_cast<char const *>(mapping);
+        memory.size = bytes.size();
+        return memory;
+    }
+
+    inline shared_memory::~shared_memory()
+    {
+        if (data != nullptr)
+            ::munmap(const_cast<char *>(data), size);
+        if (handle >= 0)
+            ::close(handle);
+    }
+#endif
+
+} // namespace dodo
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dodo
+{
+
+    enum struct help_entry_kind : uint8_t { command, option, argument };
+
+    // Command, option or positional argument whose help can be searched.
+    struct help_entry
+    {
+        help_entry_kind kind = help_entry_kind::command;
+        std::string_view name;          // Name of the command or argument, or first pattern of the option.
+        std::string_view description;
+        std::string_view command;       // Command the option or argument belongs to. Empty if it belongs to no command.
+    };
+
+    enum struct help_field : uint8_t { description, name };
+
+    struct help_search_result
+    {
+        help_entry entry;
+        uint32_t score = 0;
+    };
+
+    namespace detail
+    {
+        constexpr char ascii_to_lower(char c) noexcept
+        {
+            return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+        }
+
+        constexpr bool is_word_character(char c) noexcept
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        }
+
+        // Case insensitive, for ASCII.
+        constexpr int compare_words(std::string_view a, std::string_view b) noexcept
+        {
+            size_t const common = std::min(a.size(), b.size());
+            for (size_t i = 0; i < common; ++i)
+            {
+                char const ca = ascii_to_lower(a[i]);
+                char const cb = ascii_to_lower(b[i]);
+                if (ca != cb)
+                    return ca < cb ? -1 : 1;
+            }
+            return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+        }
+
+        constexpr bool word_starts_with(std::string_view word, std::string_view prefix) noexcept
+        {
+            return word.size() >= prefix.size() && compare_words(word.substr(0, prefix.size()), prefix) == 0;
+        }
+
+        // Calls f with each word of the text, which are the runs of letters and digits.
+        template <typename F>
+        constexpr void for_each_word(std::string_view text, F && f)
+        {
+            size_t i = 0;
+            while (i < text.size())
+            {
+                while (i < text.size() && !is_word_character(text[i]))
+                    ++i;
+
+                size_t const word_start = i;
+                while (i < text.size() && is_word_character(text[i]))
+                    ++i;
+
+                if (i > word_start)
+                    f(text.substr(word_start, i - word_start));
+            }
+        }
+    }
+
+    // Number of entries and of occurrences of words in them, for sizing a help_index.
+    struct help_index_size
+    {
+        constexpr void insert(help_entry const & entry) noexcept
+        {
+            ++entries;
+            add_name(entry.name);
+            add_name(entry.description);
+        }
+
+        constexpr void add_name(std::string_view name) noexcept
+        {
+            detail::for_each_word(name, [this](std::string_view) { ++postings; });
+        }
+
+        size_t entries = 0;
+        size_t postings = 0;
+    };
+
+    // Inverted index from the words in the names and descriptions of commands, options and arguments to where they appear, which can be
+    // built at compile time. Searching takes a binary search per keyword and only looks at the entries that contain it.
+    template <size_t EntryCapacity, size_t PostingCapacity>
+    struct help_index
+    {
+        struct posting
+        {
+            std::string_view word;
+            uint32_t entry = 0;
+            help_field field = help_field::description;
+        };
+
+        // Words in the name rank higher than words in the description. finish must be called once everything has been inserted.
+        constexpr void insert(help_entry const & entry) noexcept
+        {
+            entries[entry_count++] = entry;
+            add_name(entry.name);
+            index_words(entry.description, help_field::description);
+        }
+
+        // Adds another name to the last entry inserted, such as another pattern of an option.
+        constexpr void add_name(std::string_view name) noexcept
+        {
+            index_words(name, help_field::name);
+        }
+
+        constexpr void finish() noexcept
+        {
+            std::sort(postings, postings + posting_count, [](posting const & a, posting const & b) { return detail::compare_words(a.word, b.word) < 0; });
+        }
+
+        // Entries with words that start with every keyword of the query, best first. Matches in names rank above matches in descriptions,
+        // and whole words above prefixes.
+        std::vector<help_search_result> search(std::string_view query) const
+        {
+            // Entries that matched every keyword so far with their scores, sorted by entry. Only the entries in the postings of the
+            // keywords are looked at, so a query costs nothing for the entries that don't contain its words.
+            std::vector<std::pair<uint32_t, uint32_t>> candidates;
+            std::vector<std::pair<uint32_t, uint32_t>> hits;
+            bool first_keyword = true;
+
+            detail::for_each_word(query, [&](std::string_view keyword)
+            {
+                if (!first_keyword && candidates.empty())
+                    return;
+
+                hits.clear();
+                posting const * it = std::lower_bound(postings, postings + posting_count, keyword,
+                    [](posting const & p, std::string_view k) { return detail::compare_words(p.word, k) < 0; });
+
+                for (; it != postings + posting_count && detail::word_starts_with(it->word, keyword); ++it)
+                {
+                    uint32_t const score = (it->field == help_field::name ? 3 : 1) + (it->word.size() == keyword.size() ? 1 : 0);
+                    hits.emplace_back(it->entry, score);
+                }
+
+                // Only the best match of the keyword in each entry counts, so the hits are sorted by entry, best first, and the rest dropped.
+                std::sort(hits.begin(), hits.end(), [](auto const & a, auto const & b) { return a.first != b.first ? a.first < b.first : a.second > b.second; });
+                hits.erase(std::unique(hits.begin(), hits.end(), [](auto const & a, auto const & b) { return a.first == b.first; }), hits.end());
+
+                if (first_keyword)
+                {
+                    candidates.swap(hits);
+                    first_keyword = false;
+                    return;
+                }
+
+                // Both lists are sorted by entry, so they are intersected with a single merge.
+                size_t kept = 0;
+                size_t h = 0;
+                for (auto const & [entry, score] : candidates)
+                {
+                    while (h < hits.size() && hits[h].first < entry)
+                        ++h;
+                    if (h < hits.size() && hits[h].first == entry)
+                        candidates[kept++] = {entry, score + hits[h].second};
+                }
+                candidates.resize(kept);
+            });
+
+            std::vector<help_search_result> results;
+            results.reserve(candidates.size());
+            for (auto const & [entry, score] : candidates)
+                results.push_back(help_search_result{entries[entry], score});
+
+            std::stable_sort(results.begin(), results.end(), [](help_search_result const & a, help_search_result const & b)
+            {
+                if (a.score != b.score)
+                    return a.score > b.score;
+                return a.entry.kind < b.entry.kind;
+            });
+
+            return results;
+        }
+
+        help_entry entries[EntryCapacity > 0 ? EntryCapacity : 1] = {};
+        posting postings[PostingCapacity > 0 ? PostingCapacity : 1] = {};
+        size_t entry_count = 0;
+        size_t posting_count = 0;
+
+    private:
+        constexpr void index_words(std::string_view text, help_field field) noexcept
+        {
+            uint32_t const entry = uint32_t(entry_count - 1);
+            detail::for_each_word(text, [&](std::string_view word) { postings[posting_count++] = posting{word, entry, field}; });
+        }
+    };
+
+} // namespace dodo
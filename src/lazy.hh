@@ -0,0 +1,95 @@
+#pragma once
+
+#include "parse_traits.hh"
+#include <atomic>
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dodo
+{
+
+    // Value that may be computed the first time it is read, for options whose defaults are expensive to find, such as the number of
+    // processors or the memory of the machine. Values that were parsed are held directly. Deferred values are computed at most once, even
+    // when several threads read them at the same time, and copies share the computed value.
+    template <typename T>
+    struct lazy
+    {
+        using value_type = T;
+
+        lazy() requires std::default_initializable<T> : value(T()) {}
+        lazy(T value_) : value(std::move(value_)) {}
+
+        // Value that is computed with compute the first time it is read.
+        template <std::invocable F>
+        static lazy deferred(F compute)
+        {
+            lazy l;
+            l.value.reset();
+            l.state = std::make_shared<deferred_state>();
+            l.state->compute = std::move(compute);
+            return l;
+        }
+
+        T const & get() const
+        {
+            if (value)
+                return *value;
+
+            std::call_once(state->once, [this]()
+            {
+                state->value.emplace(state->compute());
+                state->compute = nullptr;
+                state->computed.store(true, std::memory_order_release);
+            });
+            return *state->value;
+        }
+
+        T const & operator * () const { return get(); }
+        T const * operator -> () const { return &get(); }
+
+        // Whether reading the value would not compute it.
+        bool is_computed() const noexcept { return value || state->computed.load(std::memory_order_acquire); }
+
+    private:
+        struct deferred_state
+        {
+            std::once_flag once;
+            std::atomic<bool> computed = false;
+            std::optional<T> value;
+            std::function<T()> compute;
+        };
+
+        std::optional<T> value;
+        std::shared_ptr<deferred_state> state;
+    };
+
+    template <typename T>
+    struct parse_traits<lazy<T>>
+    {
+        static auto parse(std::string_view text) noexcept -> std::optional<lazy<T>>
+        {
+            auto value = parse_traits<T>::parse(text);
+            if (!value)
+                return std::nullopt;
+            return lazy<T>(std::move(*value));
+        }
+
+        static std::string to_string(lazy<T> const & l)
+        {
+            return std::string(parse_traits<T>::to_string(l.get()));
+        }
+
+        template <Sink S>
+        static constexpr void write(S & sink, lazy<T> const & l) requires TraitWritable<T>
+        {
+            parse_traits<T>::write(sink, l.get());
+        }
+    };
+
+} // namespace dodo
@@ -2,6 +2,15 @@
 #include "catch2/catch.hpp"
 
 #include "dodo.hh"
+#include "command_scheduler.hh"
+#include "completion_file.hh"
+#include "completion_providers.hh"
+#include "flat_image.hh"
+#include "parse_cache.hh"
+#include "reloadable_config.hh"
+#include <cmath>
+#include <fstream>
+#include <sstream>
 #include <typeinfo>
 
 using namespace std::literals;
@@ -359,6 +368,1447 @@ TEST_CASE("Combining several parsers in commands")
     }
 }
 
+TEST_CASE("Compact parse results only take the memory of the command that was parsed")
+{
+    constexpr auto cli =
+        dodo::Command("configure", "",
+            dodo_Opt(std::string, name)["--name"]("Name of the project").by_default("unnamed"sv) |
+            dodo_Opt(std::string, root)["--root"]("Root directory").by_default("."sv) |
+            dodo_Opt(std::string, generator)["--generator"]("Build system generator").by_default("ninja"sv) |
+            dodo_Opt(std::string, toolchain)["--toolchain"]("Toolchain file").by_default(""sv)
+        )
+        | tests::Help();
+
+    using Compact = decltype(cli)::compact_parse_result_type;
+
+    STATIC_REQUIRE(sizeof(Compact) < sizeof(dodo_parse_result_type(cli)));
+
+    SECTION("Small results are stored inline")
+    {
+        auto const result = cli.parse_compact(std::span<std::string_view const>({"--help"sv}));
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 1);
+        REQUIRE(result->is_stored_inline());
+    }
+    SECTION("Big results are allocated from the given memory resource")
+    {
+        std::byte buffer[1024];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer));
+
+        auto const result = cli.parse_compact(std::span<std::string_view const>({"configure"sv, "--name=dodo"sv}), &arena);
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 0);
+        REQUIRE(!result->is_stored_inline());
+        REQUIRE(result->get<0>().name == "dodo");
+        REQUIRE(result->get<0>().generator == "ninja");
+
+        Compact const copy = *result;
+        REQUIRE(copy.visit(dodo::overload(
+            [](tests::ShowHelp) { return false; },
+            [](auto const & configure) { return configure.root == "."; }
+        )));
+
+        // As with std::visit, visiting a variant that has been moved from throws.
+        Compact moved = copy;
+        Compact const destination = std::move(moved);
+        REQUIRE(destination.index() == 0);
+        REQUIRE_THROWS_AS(moved.visit([](auto const &) {}), std::bad_variant_access);
+    }
+    SECTION("Unrecognized command")
+    {
+        auto const result = cli.parse_compact(std::span<std::string_view const>({"build"sv}));
+
+        REQUIRE(!result.has_value());
+    }
+}
+
+TEST_CASE("Abbreviated parsers accept unique prefixes of option patterns")
+{
+    constexpr auto options =
+        dodo_Opt(int, width)["-w"]["--width"]("Width of the screen").by_default(1920)
+        | dodo_Flag(verbose)["--verbose"]("Print everything")
+        | dodo_Flag(version)["--version"]("Print the version");
+
+    constexpr auto cli = dodo_Abbreviated(options);
+
+    SECTION("Exact patterns")
+    {
+        auto const result = tests::parse(cli, {"-w=10", "--verbose"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->width == 10);
+        REQUIRE(result->verbose == true);
+        REQUIRE(result->version == false);
+    }
+    SECTION("Unique prefixes")
+    {
+        auto const result = tests::parse(cli, {"--wid=10", "--vers=true"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->width == 10);
+        REQUIRE(result->verbose == false);
+        REQUIRE(result->version == true);
+    }
+    SECTION("Ambiguous prefix")
+    {
+        auto const result = tests::parse(cli, {"--ver"});
+
+        REQUIRE(!result.has_value());
+    }
+    SECTION("Only dashes")
+    {
+        auto const result = tests::parse(cli, {"--=5"});
+
+        REQUIRE(!result.has_value());
+    }
+}
+
+TEST_CASE("Abbreviated parsers accept unique prefixes of command names")
+{
+    constexpr auto commit_options =
+        dodo_Opt(std::string, message)["-m"]["--message"]("Commit message")
+        | dodo_Flag(amend)["--amend"]("Amend the previous commit");
+
+    constexpr auto commands =
+        dodo::Command("status", "Show the working tree status", dodo_Flag(short_format)["--short"]("Short format"))
+        | dodo::Command("stash", "Stash the changes", dodo_Flag(include_untracked)["--include-untracked"]("Stash untracked files too"))
+        | dodo::Command("commit", "Record changes", dodo_Abbreviated(commit_options))
+        | tests::Help();
+
+    constexpr auto cli = dodo_Abbreviated(commands);
+
+    SECTION("Exact name")
+    {
+        auto const result = tests::parse(cli, {"stash"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 1);
+    }
+    SECTION("Unique prefix")
+    {
+        auto const result = tests::parse(cli, {"stat", "--short"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 0);
+        REQUIRE(std::get<0>(*result).short_format == true);
+    }
+    SECTION("Abbreviations in the command and its options")
+    {
+        auto const result = tests::parse(cli, {"c", "--mess=foo", "--am"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 2);
+        REQUIRE(std::get<2>(*result).message == "foo");
+        REQUIRE(std::get<2>(*result).amend == true);
+    }
+    SECTION("Ambiguous prefix")
+    {
+        auto const result = tests::parse(cli, {"sta"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Ambiguous command \"sta\"");
+    }
+    SECTION("Commands that are not matched by name still work")
+    {
+        auto const result = tests::parse(cli, {"-?"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 3);
+    }
+}
+
+TEST_CASE("Bounded edit distance")
+{
+    STATIC_REQUIRE(dodo::bounded_edit_distance("kitten", "sitting", 5) == 3);
+    STATIC_REQUIRE(dodo::bounded_edit_distance("sitting", "kitten", 5) == 3);
+    STATIC_REQUIRE(dodo::bounded_edit_distance("kitten", "sitting", 2) == 3); // Bound exceeded.
+    STATIC_REQUIRE(dodo::bounded_edit_distance("", "abc", 5) == 3);
+    STATIC_REQUIRE(dodo::bounded_edit_distance("--verbose", "--verbose", 2) == 0);
+    STATIC_REQUIRE(dodo::bounded_edit_distance("--verbose", "--vrebose", 2) == 2);
+
+    std::string const long_a(100, 'a');
+    std::string long_b = long_a;
+    long_b[50] = 'b';
+    long_b += 'c';
+    CHECK(dodo::bounded_edit_distance(long_a, long_b, 3) == 2);
+}
+
+TEST_CASE("Unrecognized commands and arguments suggest the closest names")
+{
+    constexpr auto cli =
+        dodo::Command("open-window", "",
+            dodo_Opt(int, width)["-w"]["--width"]("Width of the screen") |
+            dodo_Opt(int, height)["-h"]["--height"]("Height of the screen")
+        )
+        | dodo::Command("fetch-url", "",
+            dodo_Opt(std::string, url)["--url"]("Url to fetch")
+        )
+        | dodo::Command("fetch-uri", "",
+            dodo_Opt(std::string, uri)["--uri"]("Uri to fetch")
+        );
+
+    SECTION("Misspelled command")
+    {
+        auto const result = tests::parse(cli, {"opne-window"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Unrecognized command \"opne-window\"\nDid you mean \"open-window\"?");
+    }
+    SECTION("Several suggestions")
+    {
+        auto const result = tests::parse(cli, {"fetch-ur"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Unrecognized command \"fetch-ur\"\nDid you mean one of \"fetch-url\", \"fetch-uri\"?");
+    }
+    SECTION("Nothing close")
+    {
+        auto const result = tests::parse(cli, {"commit"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Unrecognized command \"commit\"");
+    }
+    SECTION("Misspelled option")
+    {
+        auto const result = tests::parse(cli, {"open-window", "--widht=5", "-h=6"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Unrecognized argument \"--widht=5\"\nDid you mean \"--width\"?");
+    }
+    SECTION("Precomputed index")
+    {
+        constexpr auto index = dodo_SuggestionIndex(cli);
+
+        REQUIRE(index.suggest("fetch-rul") == std::vector{"fetch-url"sv});
+    }
+}
+
+TEST_CASE("Perfect hash finds every key and nothing else")
+{
+    constexpr std::string_view keys[] = {"ls", "cat", "echo", "grep", "sed", "awk", "head", "tail", "sort", "uniq", "ls"};
+    constexpr uint32_t values[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    constexpr dodo::perfect_hash<std::size(keys)> hash(keys, values);
+
+    static_assert(hash.find("cat") == 1u);
+    static_assert(hash.find("uniq") == 9u);
+    static_assert(hash.find("ls") == 0u);
+    static_assert(!hash.find("dog"));
+    static_assert(!hash.find(""));
+
+    for (size_t i = 0; i < std::size(keys) - 1; ++i)
+        REQUIRE(hash.find(keys[i]) == values[i]);
+}
+
+TEST_CASE("Multicall binaries choose the tool by the name they were called with")
+{
+    constexpr auto tools =
+        dodo::Command("ls", "List directory contents", dodo_Flag(all)["-a"]("Show hidden files"))
+        | dodo::Command("cat", "Concatenate files", dodo_Flag(number)["-n"]("Number the lines"))
+        | dodo::Command("echo", "Print a line of text", dodo_Flag(no_newline)["-n"]("Do not print a newline"));
+
+    constexpr auto cli = dodo::Multicall("toolbox", tools);
+
+    static_assert(dodo::program_basename("/usr/bin/cat") == "cat");
+    static_assert(dodo::program_basename("C:\\tools\\echo.exe") == "echo");
+    static_assert(dodo::program_basename("ls") == "ls");
+
+    SECTION("Tool chosen by the program name")
+    {
+        auto const result = tests::parse(cli, {"/usr/bin/cat", "-n"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 1);
+        REQUIRE(std::get<1>(*result).number == true);
+    }
+    SECTION("Windows paths")
+    {
+        auto const result = tests::parse(cli, {"C:\\tools\\echo.exe", "-n"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 2);
+        REQUIRE(std::get<2>(*result).no_newline == true);
+    }
+    SECTION("Tool chosen by the first argument when called by the name of the binary")
+    {
+        auto const result = tests::parse(cli, {"./toolbox", "ls", "-a"});
+
+        REQUIRE(result.has_value());
+        REQUIRE(result->index() == 0);
+        REQUIRE(std::get<0>(*result).all == true);
+    }
+    SECTION("Unknown program name")
+    {
+        auto const result = tests::parse(cli, {"/usr/bin/cas"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Unrecognized program name \"cas\"\nDid you mean \"cat\"?");
+    }
+    SECTION("Unknown tool when called by the name of the binary")
+    {
+        auto const result = tests::parse(cli, {"./toolbox", "ecko"});
+
+        REQUIRE(!result.has_value());
+        REQUIRE(result.error() == "Unrecognized command \"ecko\"\nDid you mean \"echo\"?");
+        REQUIRE(!tests::parse(cli, {"./toolbox"}).has_value());
+    }
+}
+
+TEST_CASE("Args parsed from a command line can be moved and copied")
+{
+    dodo::Args args = dodo::Args::from_command_line("go 'a b'");
+    dodo::Args const moved = std::move(args);
+    dodo::Args const copied = moved;
+
+    REQUIRE(tests::are_equal(moved, {"go"sv, "a b"sv}));
+    REQUIRE(tests::are_equal(copied, {"go"sv, "a b"sv}));
+}
+
+TEST_CASE("Command scheduler spreads queued commands over ticks within a time budget")
+{
+    constexpr auto commands =
+        dodo::Command("spawn", "Spawn an entity", dodo_Opt(int, count)["--count"]("Number of entities"))
+        | dodo::Command("quit", "Quit the game", dodo_Flag(force)["--force"]("Do not ask for confirmation"));
+
+    dodo::CommandScheduler scheduler(commands);
+    for (int i = 0; i < 10; ++i)
+        scheduler.push("spawn --count=" + std::to_string(i));
+    scheduler.push("quit");
+
+    std::vector<size_t> dispatched_indices;
+    auto const handler = [&](auto const & result)
+    {
+        REQUIRE(result.has_value());
+        dispatched_indices.push_back(result->index());
+    };
+
+    REQUIRE(scheduler.stats().queue_depth == 11);
+
+    SECTION("At least one command is dispatched per tick")
+    {
+        REQUIRE(scheduler.tick(std::chrono::nanoseconds(0), handler) == 1);
+        REQUIRE(scheduler.stats().queue_depth == 10);
+        REQUIRE(scheduler.stats().dispatched == 1);
+    }
+    SECTION("Everything is dispatched in order if there is time")
+    {
+        REQUIRE(scheduler.tick(std::chrono::hours(1), handler) == 11);
+        REQUIRE(scheduler.empty());
+        REQUIRE(dispatched_indices.size() == 11);
+        REQUIRE(dispatched_indices.back() == 1);
+        REQUIRE(scheduler.stats().budget_overruns == 0);
+    }
+    SECTION("Commands that take longer than the budget count as overruns and the rest is left for the next tick")
+    {
+        auto const slow_handler = [&](auto const & result)
+        {
+            handler(result);
+            auto const start = std::chrono::steady_clock::now();
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1)) {}
+        };
+
+        REQUIRE(scheduler.tick(std::chrono::microseconds(10), slow_handler) == 1);
+        REQUIRE(scheduler.stats().budget_overruns == 1);
+        REQUIRE(scheduler.stats().queue_depth == 10);
+        REQUIRE(scheduler.stats().max_queue_depth == 11);
+    }
+}
+
+TEST_CASE("Batches of commands are split at unquoted separators")
+{
+    std::vector<dodo::Args> const batch = dodo::Args::batch_from_command_line("set fov 90; say 'a;b' c\\;d;; quit");
+
+    REQUIRE(batch.size() == 3);
+    REQUIRE(tests::are_equal(batch[0], {"set"sv, "fov"sv, "90"sv}));
+    REQUIRE(tests::are_equal(batch[1], {"say"sv, "a;b"sv, "c;d"sv}));
+    REQUIRE(tests::are_equal(batch[2], {"quit"sv}));
+
+    std::vector<dodo::Args> const trailing_backslash = dodo::Args::batch_from_command_line("say hi; quit now\\");
+    REQUIRE(trailing_backslash.size() == 2);
+    REQUIRE(tests::are_equal(trailing_backslash[1], {"quit"sv, "now"sv}));
+}
+
+TEST_CASE("Batch dispatch only runs the last coalescing command with each key")
+{
+    constexpr auto set_arguments =
+        dodo_Arg(std::string_view, variable, "variable")("Name of the variable")
+        | dodo_Arg(std::string_view, value, "value")("New value of the variable");
+
+    constexpr auto commands =
+        dodo::Command("set", "Set a console variable", set_arguments).coalesce_by([](auto const & args) { return args.variable; })
+        | dodo::Command("say", "Print a message", dodo_Arg(std::string_view, message, "message")("Message to print"));
+
+    std::vector<dodo::Args> const batch = dodo::Args::batch_from_command_line("set fov 90; say hi; set fov 95; set gamma 2.2; say hi; set fov 100; bogus");
+
+    std::vector<std::string> dispatched;
+    size_t const dispatched_count = commands.dispatch_batch(batch, [&](auto const & result)
+    {
+        if (!result)
+            dispatched.push_back(result.error());
+        else if (result->index() == 0)
+            dispatched.push_back(std::string(std::get<0>(*result).variable) + "=" + std::string(std::get<0>(*result).value));
+        else
+            dispatched.push_back(std::string(std::get<1>(*result).message));
+    });
+
+    REQUIRE(dispatched_count == 5);
+    REQUIRE(tests::are_equal(dispatched, {"hi"s, "gamma=2.2"s, "hi"s, "fov=100"s, "Unrecognized command \"bogus\""s}));
+}
+
+TEST_CASE("Help requests are found without parsing the arguments")
+{
+    constexpr auto cli =
+        dodo::SharedOptions(dodo_Opt(int, verbosity)["--verbosity"]("How much to log"))
+        | dodo::Command("build", "Build the project", dodo_Opt(int, jobs)["-j"]("Number of parallel jobs"))
+        | dodo::Command("clean", "Remove build files", dodo_Flag(all)["--all"]("Remove the cache too"));
+
+    SECTION("Help of a command, even if the values can't be parsed")
+    {
+        std::optional<dodo::help_request> const help = dodo::find_help_request(cli, dodo::Args({"--verbosity=lots", "build", "-j=many", "--help"}));
+
+        REQUIRE(help.has_value());
+        REQUIRE(help->command == "build");
+    }
+    SECTION("Help command followed by the name of a command")
+    {
+        std::optional<dodo::help_request> const help = dodo::find_help_request(cli, dodo::Args({"help", "clean"}));
+
+        REQUIRE(help.has_value());
+        REQUIRE(help->command == "clean");
+    }
+    SECTION("Help of the whole program")
+    {
+        std::optional<dodo::help_request> const help = dodo::find_help_request(cli, dodo::Args({"-h"}));
+
+        REQUIRE(help.has_value());
+        REQUIRE(help->command.empty());
+    }
+    SECTION("No help")
+    {
+        REQUIRE(!dodo::find_help_request(cli, dodo::Args({"build", "-j=4"})).has_value());
+    }
+    SECTION("Commands found in a perfect hash of their names")
+    {
+        static constexpr auto names = dodo_CommandNames(cli);
+
+        REQUIRE(dodo::find_help_request(cli, names, dodo::Args({"--verbosity=lots", "clean", "--help"}))->command == "clean");
+        REQUIRE(dodo::find_help_request(cli, names, dodo::Args({"help", "build"}))->command == "build");
+        REQUIRE(dodo::find_help_request(cli, names, dodo::Args({"--help"}))->command.empty());
+        REQUIRE(!dodo::find_help_request(cli, names, dodo::Args({"build"})).has_value());
+    }
+    SECTION("Parsers without commands")
+    {
+        constexpr auto options = dodo_Opt(int, width)["--width"]("Width of the window");
+
+        REQUIRE(dodo::find_help_request(options, dodo::Args({"--width=wide", "--help"})).has_value());
+    }
+}
+
+TEST_CASE("Static help is the same text as to_string, built at compile time")
+{
+    constexpr auto options =
+        dodo_Opt(int, width)["-w"]["--width"]("Width of the window").by_default(-1920)
+        | dodo_Opt(float, scale)["--scale"]("Scale of the interface").by_default(1.25f)
+        | dodo_Opt(double, gamma)["--gamma"]("Gamma correction").by_default(2.2)
+        | dodo_Flag(fullscreen)["--fullscreen"]("Start in fullscreen")
+        | dodo_Opt(std::vector<int>, monitors)["--monitors"]("Monitors to use").by_default_range(1, 2).implicitly_range(0);
+
+    constexpr auto cli =
+        dodo::SharedOptions(options)
+        | dodo::Command("run", "Run the game", dodo_Arg(std::string_view, level, "level")("Level to load").by_default("intro"sv) | options)
+        | dodo::Command("editor", "Open the editor", options);
+
+    static constexpr auto help = dodo_StaticHelp(cli);
+
+    STATIC_REQUIRE(help.size == dodo::help_size(cli));
+    REQUIRE(help.view() == cli.to_string());
+    REQUIRE(help.view().find("By default: 2.200000") != std::string_view::npos);
+}
+
+TEST_CASE("Help can be streamed to strings, output streams and fixed buffers")
+{
+    constexpr auto cli =
+        dodo::Command("build", "Build the project", dodo_Opt(int, jobs)["-j"]("Number of parallel jobs").by_default(4))
+        | dodo::Command("clean", "Remove build files", dodo_Flag(all)["--all"]("Remove the cache too"))
+        | tests::Help();
+
+    std::string const expected = cli.to_string();
+
+    SECTION("String")
+    {
+        std::string out = "Commands:\n";
+        dodo::write_help(cli, out);
+
+        REQUIRE(out == "Commands:\n" + expected);
+    }
+    SECTION("Output stream")
+    {
+        std::ostringstream out;
+        dodo::write_help(cli, out, 2);
+
+        REQUIRE(out.str() == cli.to_string(2));
+    }
+    SECTION("Fixed buffer")
+    {
+        char buffer[32];
+        dodo::buffer_sink sink(buffer);
+        dodo::write_help(cli, sink);
+
+        REQUIRE(sink.truncated);
+        REQUIRE(sink.view() == std::string_view(expected).substr(0, 32));
+    }
+#if !defined(_WIN32)
+    SECTION("File descriptor")
+    {
+        std::filesystem::path const path = std::filesystem::temp_directory_path() / "dodo_file_descriptor_sink_test.txt";
+        int const file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        REQUIRE(file >= 0);
+        {
+            dodo::file_descriptor_sink sink(file);
+            for (int i = 0; i < 1000; ++i)
+                dodo::write_help(cli, sink);
+            REQUIRE(sink.flush());
+        }
+        ::close(file);
+
+        std::ifstream in(path, std::ios::binary);
+        std::string const written{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        in.close();
+        std::filesystem::remove(path);
+
+        std::string repeated;
+        for (int i = 0; i < 1000; ++i)
+            repeated += expected;
+        REQUIRE(written == repeated);
+    }
+#endif
+}
+
+TEST_CASE("Help layout fits the columns to the names and wraps descriptions to the width")
+{
+    constexpr auto cli =
+        dodo::Command("build", "Build the project with the given number of parallel jobs, or as many as hardware threads if not given",
+            dodo_Opt(int, jobs)["-j"]("Number of parallel jobs"))
+        | dodo::Command("rm", "Remove build files", dodo_Flag(all)["--all"]("Remove the cache too"));
+
+    constexpr dodo::help_layout layout = dodo::measure_help_layout(cli);
+    STATIC_REQUIRE(layout.command_column == 7);
+
+    dodo::help_cache help(cli);
+
+    SECTION("Not wrapped")
+    {
+        REQUIRE(help.text(0) ==
+            "build  Build the project with the given number of parallel jobs, or as many as hardware threads if not given\n"
+            "rm     Remove build files\n");
+    }
+    SECTION("Wrapped")
+    {
+        REQUIRE(help.text(40) ==
+            "build  Build the project with the given\n"
+            "       number of parallel jobs, or as\n"
+            "       many as hardware threads if not\n"
+            "       given\n"
+            "rm     Remove build files\n");
+    }
+    SECTION("Repeated requests for the same width are cached")
+    {
+        REQUIRE(help.text(40).data() == help.text(40).data());
+    }
+}
+
+TEST_CASE("Help of a single command and summaries")
+{
+    constexpr auto cli =
+        dodo::SharedOptions(dodo_Opt(int, verbosity)["--verbosity"]("How much to log").by_default(1))
+        | dodo::Command("build", "Build the project", dodo_Opt(int, jobs)["-j"]("Number of parallel jobs").by_default(4))
+        | dodo::Command("clean", "Remove build files", dodo_Flag(all)["--all"]("Remove the cache too"))
+        | tests::Help();
+
+    SECTION("Help of a command")
+    {
+        REQUIRE(dodo::help_for(cli, "build") ==
+            "build                    Build the project\n"
+            "  -j <int>                              Number of parallel jobs\n"
+            "                                        By default: 4\n");
+    }
+    SECTION("Commands without a parser")
+    {
+        REQUIRE(dodo::help_for(cli, "help") == tests::Help().to_string(0));
+    }
+    SECTION("Unknown command")
+    {
+        REQUIRE(!dodo::help_for(cli, "deploy").has_value());
+    }
+    SECTION("Summary")
+    {
+        std::string summary;
+        dodo::write_help_summary(cli, summary);
+
+        REQUIRE(summary == cli.commands.to_string());
+    }
+    SECTION("Summary of options leaves out their values")
+    {
+        std::string summary;
+        dodo::write_help_summary(dodo_Opt(int, jobs)["-j"]("Number of parallel jobs").by_default(4), summary);
+
+        REQUIRE(summary == "-j <int>                                Number of parallel jobs\n");
+    }
+}
+
+TEST_CASE("Help search finds commands and options by keyword, best matches first")
+{
+    constexpr auto cli =
+        dodo::Command("build", "Build the project", dodo_Opt(int, jobs)["-j"]["--jobs"]("Number of parallel jobs").by_default(4))
+        | dodo::Command("clean", "Remove build files", dodo_Flag(all)["--all"]("Remove the cache too"))
+        | dodo::Command("cache", "Show the size of the build cache", dodo_Flag(human)["--human"]("Sizes in readable units"));
+
+    static constexpr auto index = dodo_HelpIndex(cli);
+
+    SECTION("Name matches rank above description matches")
+    {
+        auto const results = index.search("build");
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[0].entry.name == "build");
+        REQUIRE(results[0].entry.kind == dodo::help_entry_kind::command);
+        REQUIRE(results[1].entry.name == "clean");
+        REQUIRE(results[2].entry.name == "cache");
+    }
+    SECTION("Options know the command they belong to and match any of their patterns")
+    {
+        auto const results = index.search("jobs");
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].entry.kind == dodo::help_entry_kind::option);
+        REQUIRE(results[0].entry.name == "-j");
+        REQUIRE(results[0].entry.command == "build");
+    }
+    SECTION("Every keyword must match, by prefix and ignoring case")
+    {
+        auto const results = index.search("CACHE rem");
+        REQUIRE(results.size() == 1);
+        REQUIRE(results[0].entry.name == "--all");
+        REQUIRE(results[0].entry.command == "clean");
+    }
+    SECTION("No matches")
+    {
+        REQUIRE(index.search("deploy").empty());
+    }
+}
+
+TEST_CASE("Completion of commands, option patterns and values in the context of the command line")
+{
+    constexpr auto cli =
+        dodo::SharedOptions(dodo_Opt(int, verbosity)["--verbosity"]("How much to log").by_default(1))
+        | dodo::Command("build", "Build the project", dodo_Opt(int, jobs)["-j"]["--jobs"]("Number of parallel jobs").by_default(4))
+        | dodo::Command("bench", "Run benchmarks", dodo_Flag(quick)["--quick"]("Run fewer iterations"))
+        | dodo::Command("clean", "Remove build files", dodo_Flag(all)["--all"]("Remove the cache too"));
+
+    static constexpr auto index = dodo_CompletionIndex(cli);
+
+    auto const complete = [](std::string command_line)
+    {
+        std::string out;
+        REQUIRE(dodo::answer_completion_request(index, dodo::Args({dodo::completion_request, command_line}), out));
+        return out;
+    };
+
+    SECTION("Commands and shared options at the start of the command line")
+    {
+        REQUIRE(complete("tool b") == "bench\nbuild\n");
+        REQUIRE(complete("tool ") == "--verbosity\nbench\nbuild\nclean\n");
+    }
+    SECTION("Options of the command being written")
+    {
+        REQUIRE(complete("tool --verbosity=2 build -") == "--jobs\n-j\n");
+        REQUIRE(complete("tool clean ") == "--all\n");
+    }
+    SECTION("Values of options whose type lists them")
+    {
+        REQUIRE(complete("tool bench --quick=") == "--quick=false\n--quick=true\n");
+        REQUIRE(complete("tool bench --quick=t") == "--quick=true\n");
+        REQUIRE(complete("tool build --jobs=").empty());
+    }
+    SECTION("Nothing matches")
+    {
+        REQUIRE(complete("tool deploy").empty());
+    }
+    SECTION("Blank command lines have no program name to complete after")
+    {
+        REQUIRE(complete("").empty());
+        REQUIRE(complete("   ").empty());
+
+        std::string out;
+        REQUIRE(dodo::answer_completion_request(index, dodo::Args({dodo::completion_request}), out));
+        REQUIRE(out.empty());
+        REQUIRE(dodo::Args::from_command_line_skip_program_name("  \t ").empty());
+        REQUIRE(dodo::Args::from_command_line_skip_program_name(std::string(2000, 'p') + " build").size() == 1);
+    }
+    SECTION("Arguments that are not a completion request")
+    {
+        std::string out;
+        REQUIRE(!dodo::answer_completion_request(index, dodo::Args({"build", "-j=2"}), out));
+    }
+}
+
+TEST_CASE("Completion of option values given by completion providers")
+{
+    static constexpr std::string_view colors[] = {"red", "green", "blue"};
+    static int job_listings = 0;
+    static dodo::completion_cache cache;
+    constexpr auto list_jobs = [](std::string_view, std::vector<std::string> & jobs)
+    {
+        ++job_listings;
+        jobs.push_back("1042");
+        jobs.push_back("1337");
+        jobs.push_back("2001");
+    };
+
+    constexpr auto cli =
+        dodo::Command("paint", "Paint the canvas", dodo_Opt(std::string, color)["--color"]("Color to paint with").complete_with(dodo::completion_values{colors}))
+        | dodo::Command("kill", "Stop a job", dodo_Opt(int, job)["--job"]("Job to stop").complete_with(dodo::cached_completion{list_jobs, &cache, "jobs", std::chrono::hours(1)}));
+
+    static constexpr auto index = dodo_CompletionIndex(cli);
+
+    auto const complete = [&](std::string command_line)
+    {
+        std::string out;
+        REQUIRE(dodo::answer_completion_request(cli, index, dodo::Args({dodo::completion_request, command_line}), out));
+        return out;
+    };
+
+    SECTION("Values known at compile time are in the index")
+    {
+        REQUIRE(complete("tool paint --color=") == "--color=blue\n--color=green\n--color=red\n");
+        REQUIRE(complete("tool paint --color=g") == "--color=green\n");
+    }
+    SECTION("Values known when completing are asked to the provider and cached by key")
+    {
+        job_listings = 0;
+        cache.clear();
+
+        REQUIRE(complete("tool kill --job=1") == "--job=1042\n--job=1337\n");
+        REQUIRE(complete("tool kill --job=13") == "--job=1337\n");
+        REQUIRE(job_listings == 1);
+
+        cache.invalidate("jobs");
+        REQUIRE(complete("tool kill --job=2") == "--job=2001\n");
+        REQUIRE(job_listings == 2);
+    }
+    SECTION("Providers are only called for values of their option")
+    {
+        job_listings = 0;
+        REQUIRE(complete("tool kill --") == "--job\n");
+        REQUIRE(job_listings == 0);
+    }
+}
+
+TEST_CASE("Path completion lists directories once until they change")
+{
+    std::filesystem::path const root = std::filesystem::temp_directory_path() / "dodo_path_completion_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "src");
+    std::ofstream(root / "src" / "main.cc").put('\n');
+    std::ofstream(root / "src" / "dodo.hh").put('\n');
+    std::ofstream(root / "src" / ".hidden").put('\n');
+
+    dodo::directory_cache cache;
+    dodo::path_completion const paths{&cache};
+    std::string const directory = (root / "src").string() + "/";
+
+    auto const complete = [&](std::string const & value)
+    {
+        std::vector<std::string> candidates;
+        paths(value, candidates);
+        std::sort(candidates.begin(), candidates.end());
+        return candidates;
+    };
+
+    REQUIRE(complete(directory + "m") == std::vector<std::string>{directory + "main.cc"});
+    REQUIRE(complete(directory) == std::vector<std::string>{directory + "dodo.hh", directory + "main.cc"});
+    REQUIRE(complete(directory + ".") == std::vector<std::string>{directory + ".hidden"});
+    REQUIRE(cache.listing_count() == 1);
+
+    // The modification time is moved forward, since creating an entry may not change it on file systems with a coarse clock.
+    std::filesystem::create_directory(root / "src" / "detail");
+    std::filesystem::last_write_time(root / "src", std::filesystem::last_write_time(root / "src") + std::chrono::seconds(1));
+    REQUIRE(complete(directory + "d") == std::vector<std::string>{directory + "detail/", directory + "dodo.hh"});
+    REQUIRE(cache.listing_count() == 2);
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Completion files answer the same as the index they were written from")
+{
+    constexpr auto cli =
+        dodo::Command("build", "Build the project", dodo_Opt(int, jobs)["-j"]["--jobs"]("Number of parallel jobs").by_default(4))
+        | dodo::Command("bench", "Run benchmarks", dodo_Flag(quick)["--quick"]("Run fewer iterations"));
+
+    static constexpr auto index = dodo_CompletionIndex(cli);
+
+    std::string bytes;
+    dodo::write_completion_file(index, bytes);
+    std::optional<dodo::completion_file> const file = dodo::completion_file::from_bytes(bytes);
+    REQUIRE(file.has_value());
+
+    for (std::string const command_line : {"tool ", "tool b", "tool build -", "tool bench --quick=", "tool clean"})
+    {
+        std::string from_index, from_file;
+        REQUIRE(dodo::answer_completion_request(index, dodo::Args({dodo::completion_request, command_line}), from_index));
+        REQUIRE(dodo::answer_completion_request(*file, dodo::Args({dodo::completion_request, command_line}), from_file));
+        REQUIRE(from_file == from_index);
+    }
+
+    REQUIRE(file->complete({}, "bu")[0].description == "Build the project");
+
+    SECTION("Malformed files are rejected")
+    {
+        REQUIRE(!dodo::completion_file::from_bytes(std::string_view(bytes).substr(0, bytes.size() - 1)).has_value());
+
+        std::string wrong_child = bytes;
+        wrong_child[20 + 8] = char(200); // First child of the root.
+        REQUIRE(!dodo::completion_file::from_bytes(wrong_child).has_value());
+    }
+}
+
+TEST_CASE("Completion scripts call the program back")
+{
+    std::string script;
+    dodo::write_completion_script(script, dodo::shell::fish, "tool");
+
+    REQUIRE(script == "complete -c tool -f -a '(\"tool\" __complete (commandline -cp))'\n");
+}
+
+TEST_CASE("Schema of a parser in JSON and CBOR")
+{
+    constexpr auto cli =
+        dodo::SharedOptions(dodo_Opt(int, verbosity)["-v"]["--verbosity"]("How much to log").by_default(1).check([](int v) { return v >= 0; }, "Must not be negative"))
+        | dodo::Command("build", "Build the \"project\"", dodo_Arg(std::string_view, target, "target")("What to build") | dodo_Flag(fast)["--fast"]("Skip checks"));
+
+    SECTION("JSON")
+    {
+        std::string schema;
+        dodo::write_schema(cli, schema);
+
+        REQUIRE(schema ==
+            R"({"options":[{"patterns":["-v","--verbosity"],"hint":"int","description":"How much to log","default":"1","checks":["Must not be negative"]}],)"
+            R"("commands":[{"name":"build","description":"Build the \"project\"","parser":{)"
+            R"("arguments":[{"name":"target","hint":"std::string_view","description":"What to build"}],)"
+            R"("options":[{"patterns":["--fast"],"hint":"bool","description":"Skip checks","default":"false","implicit":"true"}]}}]})");
+    }
+    SECTION("CBOR has the same structure")
+    {
+        std::string schema;
+        dodo::write_schema(cli, schema, dodo::schema_format::cbor);
+
+        REQUIRE(uint8_t(schema.front()) == 0xBF);   // Map of indefinite length.
+        REQUIRE(schema.substr(1, 8) == "\x67options");
+        REQUIRE(uint8_t(schema.back()) == 0xFF);    // Break.
+        REQUIRE(schema.size() < dodo::schema_size(cli));
+    }
+    SECTION("At compile time")
+    {
+        static constexpr auto schema = dodo_StaticSchema(cli, dodo::schema_format::json);
+
+        std::string runtime_schema;
+        dodo::write_schema(cli, runtime_schema);
+        REQUIRE(schema.view() == runtime_schema);
+    }
+}
+
+TEST_CASE("Footprint of a parser can be checked at compile time")
+{
+    constexpr auto build_options = dodo_Arg(std::string_view, target, "target")("What to build") | dodo_Flag(fast)["-f"]["--fast"]("Skip checks");
+    constexpr auto cli =
+        dodo::SharedOptions(dodo_Opt(int, verbosity)["-v"]["--verbosity"]("How much to log").by_default(1))
+        | dodo::Command("build", "Build the project", build_options)
+        | dodo::Command("clean", "Remove build files", dodo_Flag(all)["--all"]("Remove everything"))
+        | dodo::Command("status", "Show the status", dodo_Flag(short_format)["--short"]("Show one line per file"));
+
+    constexpr dodo::parser_footprint footprint = dodo::measure_footprint(cli);
+    static_assert(footprint.parser_size == sizeof(cli));
+    static_assert(footprint.result_size == sizeof(dodo_parse_result_type(cli)));
+    static_assert(footprint.options == 4);
+    static_assert(footprint.patterns == 6);
+    static_assert(footprint.arguments == 1);
+    static_assert(footprint.commands == 3);
+
+    // Shared options are compared with the 3 command names before their 2 patterns.
+    static_assert(footprint.max_probes_per_token == 5);
+
+    SECTION("Tools of a multicall binary are found with a single probe")
+    {
+        constexpr auto tools = dodo::Command("cat", "Print files", dodo_Flag(number)["-n"]("Number lines"))
+            | dodo::Command("echo", "Print arguments", dodo_Flag(no_newline)["-n"]("Do not print a newline"));
+        constexpr auto multicall = dodo::Multicall("toolbox", tools);
+
+        constexpr dodo::parser_footprint multicall_footprint = dodo::measure_footprint(multicall);
+        static_assert(multicall_footprint.commands == 2);
+        static_assert(multicall_footprint.max_probes_per_token == 1);
+        REQUIRE(multicall_footprint.options == 2);
+    }
+}
+
+TEST_CASE("Options can take their values from environment variables")
+{
+    constexpr auto options =
+        dodo_Opt(int, threads)["--threads"]("Number of worker threads").env("APP_THREADS").by_default(1)
+        | dodo_Opt(std::string_view, log)["--log"]("File to log to").env("APP_LOG").by_default(std::string_view("app.log"));
+    constexpr auto cli = dodo::Command("run", "Run the service", options) | dodo::Command("stop", "Stop the service", dodo_Flag(force)["--force"]("Don't wait"));
+
+    static constexpr auto environment = dodo_EnvironmentIndex(cli);
+    static_assert(dodo::environment_variable_count(cli) == 2);
+
+    char const * const entries[] = {"HOME=/home/user", "APP_THREADS=8", "=C:=C:\\", "PATH=/usr/bin"};
+    auto const values = environment.scan(entries);
+
+    SECTION("The environment is read for options that are not in the command line")
+    {
+        auto const parsed = cli.parse(dodo::Args({"run"}), {values});
+        REQUIRE(parsed);
+        auto const & run = std::get<0>(*parsed);
+        REQUIRE(run.threads == 8);
+        REQUIRE(run.log == "app.log");
+    }
+    SECTION("The command line takes precedence over the environment")
+    {
+        auto const parsed = cli.parse(dodo::Args({"run", "--threads=2"}), {values});
+        REQUIRE(parsed);
+        REQUIRE(std::get<0>(*parsed).threads == 2);
+    }
+    SECTION("Values that can't be converted name the variable")
+    {
+        char const * const bad_entries[] = {"APP_THREADS=many"};
+        auto const bad_values = environment.scan(bad_entries);
+        auto const parsed = cli.parse(dodo::Args({"run"}), {bad_values});
+        REQUIRE(!parsed);
+        REQUIRE(parsed.error().find("APP_THREADS") != std::string::npos);
+    }
+    SECTION("Help shows the variable")
+    {
+        REQUIRE(options.to_string().find("Environment: APP_THREADS") != std::string::npos);
+    }
+    SECTION("By default, the environment of the process is read")
+    {
+    #if defined(_WIN32)
+        _putenv_s("APP_THREADS", "5");
+    #else
+        setenv("APP_THREADS", "5", 1);
+    #endif
+        auto const parsed = cli.parse(dodo::Args({"run"}));
+    #if defined(_WIN32)
+        _putenv_s("APP_THREADS", "");
+    #else
+        unsetenv("APP_THREADS");
+    #endif
+        REQUIRE(parsed);
+        REQUIRE(std::get<0>(*parsed).threads == 5);
+        REQUIRE(std::get<0>(*parsed).log == "app.log");
+    }
+}
+
+TEST_CASE("Options can take their values from a config file")
+{
+    constexpr auto run_options =
+        dodo_Opt(int, threads)["-t"]["--threads"]("Number of worker threads").env("APP_THREADS").by_default(1)
+        | dodo_Opt(std::string_view, log)["--log"]("File to log to").by_default(std::string_view("app.log"));
+    constexpr auto cli =
+        dodo::SharedOptions(dodo_Opt(int, verbosity)["--verbosity"]("How much to log").by_default(0))
+        | dodo::Command("run", "Run the service", run_options)
+        | dodo::Command("stop", "Stop the service", dodo_Flag(force)["--force"]("Don't wait"));
+
+    std::string_view const text =
+        "# Settings of the service\n"
+        "verbosity = 2\n"
+        "\n"
+        "[run]\n"
+        "threads = 4 # One per core\n"
+        "log = \"/var/log/app.log\"\r\n"
+        "threads = 6\n";
+
+    auto const config = dodo::config_file::parse(text, "app.conf");
+    REQUIRE(config);
+    REQUIRE(config->entries().size() == 4);
+
+    SECTION("Values point into the text")
+    {
+        dodo::config_entry const * const log = config->find("run", "log");
+        REQUIRE(log);
+        REQUIRE(log->value == "/var/log/app.log");
+        REQUIRE(log->value.data() >= text.data());
+        REQUIRE(log->value.data() < text.data() + text.size());
+        REQUIRE(log->line == 6);
+    }
+    SECTION("Options not in the command line are read from the section of their command")
+    {
+        auto const parsed = cli.parse(dodo::Args({"run"}), {*config});
+        REQUIRE(parsed);
+        REQUIRE(parsed->shared_arguments.verbosity == 2);
+        auto const & run = std::get<0>(parsed->command);
+        REQUIRE(run.threads == 6);
+        REQUIRE(run.log == "/var/log/app.log");
+    }
+    SECTION("The command line and the environment take precedence over the config file")
+    {
+        static constexpr auto environment = dodo_EnvironmentIndex(cli);
+        char const * const entries[] = {"APP_THREADS=8"};
+        auto const values = environment.scan(entries);
+
+        auto const parsed = cli.parse(dodo::Args({"--verbosity=1", "run"}), {values, *config});
+        REQUIRE(parsed);
+        REQUIRE(parsed->shared_arguments.verbosity == 1);
+        REQUIRE(std::get<0>(parsed->command).threads == 8);
+    }
+    SECTION("Options of nested commands are read from the section of the path of commands")
+    {
+        constexpr auto git =
+            dodo::Command("remote", "Manage remotes",
+                dodo::Command("add", "Add a remote", dodo_Opt(std::string_view, url)["--url"]("Address of the remote").by_default(std::string_view()))
+                | dodo::Command("remove", "Remove a remote", dodo_Flag(force)["--force"]("Remove it even if it is in use")))
+            | dodo::Command("add", "Add files", dodo_Opt(std::string_view, url)["--url"]("Unused").by_default(std::string_view()));
+
+        auto const git_config = dodo::config_file::parse("[add]\nurl = files\n[remote.add]\nurl = https://example.com\n", "git.conf");
+        REQUIRE(git_config);
+
+        std::vector<dodo::value_origin> origins;
+        dodo::value_sources sources(*git_config);
+        sources.origins = &origins;
+        auto const remote_add = git.parse(dodo::Args({"remote", "add"}), sources);
+        REQUIRE(remote_add);
+        REQUIRE(std::get<0>(std::get<0>(*remote_add)).url == "https://example.com");
+        REQUIRE(origins.size() == 1);
+        REQUIRE(origins[0].section == "remote.add");
+
+        auto const add = git.parse(dodo::Args({"add"}), {*git_config});
+        REQUIRE(add);
+        REQUIRE(std::get<1>(*add).url == "files");
+    }
+    SECTION("Errors say the line")
+    {
+        auto const bad_syntax = dodo::config_file::parse("[run]\nthreads 4\n", "app.conf");
+        REQUIRE(!bad_syntax);
+        REQUIRE(bad_syntax.error() == "app.conf:2: Expected key = value");
+
+        auto const bad_value = dodo::config_file::parse("[run]\n\nthreads = many\n", "app.conf");
+        REQUIRE(bad_value);
+        auto const parsed = cli.parse(dodo::Args({"run"}), {*bad_value});
+        REQUIRE(!parsed);
+        REQUIRE(parsed.error().starts_with("app.conf:3: "));
+    }
+}
+
+TEST_CASE("Layered sources give each option the value with the highest precedence and say where it came from")
+{
+    constexpr auto cli =
+        dodo_Opt(int, threads)["--threads"]("Number of worker threads").env("APP_THREADS").by_default(1)
+        | dodo_Opt(int, port)["--port"]("Port to listen on").by_default(80)
+        | dodo_Opt(std::string_view, log)["--log"]("File to log to").by_default(std::string_view("app.log"))
+        | dodo_Opt(int, queue)["--queue"]("Length of the queue").env("APP_QUEUE").by_default(16);
+
+    auto const system_config = dodo::config_file::parse("port = 8080\nlog = /var/log/app.log\nthreads = 2\n", "/etc/app.conf");
+    auto const user_config = dodo::config_file::parse("port = 9090\n", "~/.app.conf");
+    REQUIRE(system_config);
+    REQUIRE(user_config);
+
+    dodo::config_file const * const files[] = {&*system_config, &*user_config};
+    dodo::config_file const config = dodo::config_file::layered(files);
+    REQUIRE(config.entries().size() == 3);
+
+    static constexpr auto environment = dodo_EnvironmentIndex(cli);
+    char const * const entries[] = {"APP_THREADS=4", "APP_QUEUE=32"};
+    auto const values = environment.scan(entries);
+
+    std::vector<dodo::value_origin> origins;
+    dodo::value_sources sources(values, config);
+    sources.origins = &origins;
+
+    auto const parsed = cli.parse(dodo::Args({"--queue=64"}), sources);
+    REQUIRE(parsed);
+    REQUIRE(parsed->threads == 4);
+    REQUIRE(parsed->port == 9090);
+    REQUIRE(parsed->log == "/var/log/app.log");
+    REQUIRE(parsed->queue == 64);
+
+    REQUIRE(origins.size() == 4);
+    REQUIRE(origins[0].option == "--threads");
+    REQUIRE(origins[0].kind == dodo::value_origin_kind::environment);
+    REQUIRE(origins[0].source == "APP_THREADS");
+    REQUIRE(origins[1].kind == dodo::value_origin_kind::config_file);
+    REQUIRE(origins[1].source == "~/.app.conf");
+    REQUIRE(origins[1].line == 1);
+    REQUIRE(origins[2].kind == dodo::value_origin_kind::config_file);
+    REQUIRE(origins[2].source == "/etc/app.conf");
+    REQUIRE(origins[2].line == 2);
+    REQUIRE(origins[3].kind == dodo::value_origin_kind::command_line);
+}
+
+TEST_CASE("Reloadable config publishes a new snapshot when its files change and keeps the last good one on errors")
+{
+    constexpr auto cli =
+        dodo_Opt(int, port)["--port"]("Port to listen on").by_default(80)
+        | dodo_Opt(int, threads)["--threads"]("Number of worker threads").by_default(1);
+
+    std::filesystem::path const root = std::filesystem::temp_directory_path() / "dodo_reloadable_config_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    std::string const path = (root / "app.conf").string();
+    std::ofstream(path) << "port = 8080\n";
+
+    dodo::ReloadableConfig config(cli, {path}, dodo::Args({"--threads=4"}));
+    REQUIRE(config.snapshot() == nullptr);
+    REQUIRE(!config.reload().has_value());
+
+    auto const first = config.snapshot();
+    REQUIRE(first != nullptr);
+    REQUIRE(first->port == 8080);
+    REQUIRE(first->threads == 4);
+    REQUIRE(!config.files_changed());
+
+    SECTION("A change is picked up and old snapshots stay valid")
+    {
+        std::ofstream(path) << "port = 9090\nthreads = 2\n";
+        std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+
+        REQUIRE(!config.reload_if_changed().has_value());
+        REQUIRE(config.snapshot()->port == 9090);
+        REQUIRE(config.snapshot()->threads == 4);
+        REQUIRE(first->port == 8080);
+    }
+    SECTION("A change that fails to parse keeps the last good snapshot")
+    {
+        std::ofstream(path) << "port = eighty\n";
+        std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+
+        REQUIRE(config.reload_if_changed().has_value());
+        REQUIRE(config.snapshot() == first);
+    }
+    SECTION("A file that is removed to be written again keeps the last good snapshot")
+    {
+        std::filesystem::remove(path);
+
+        REQUIRE(config.files_changed());
+        REQUIRE(config.reload().has_value());
+        REQUIRE(config.snapshot() == first);
+        REQUIRE(config.version() == 1);
+
+        std::ofstream(path) << "port = 9090\n";
+        REQUIRE(!config.reload().has_value());
+        REQUIRE(config.snapshot()->port == 9090);
+        REQUIRE(config.version() == 2);
+    }
+
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Parse cache loads the results of arguments it parsed before from disk")
+{
+    static int checks = 0;
+    auto const cli =
+        dodo::Command("build", "Build the targets",
+            dodo_Opt(int, jobs)["--jobs"]("Number of jobs").check([](int jobs) { ++checks; return jobs > 0; }, "Jobs must be positive").by_default(1)
+            | dodo_Opt(std::string_view, target)["--target"]("Target to build").env("APP_TARGET").by_default(std::string_view("all"))
+            | dodo_Opt(std::vector<int>, levels)["--levels"]("Levels to build").by_default(std::vector<int>()))
+        | dodo::Command("clean", "Remove the outputs", dodo_Flag(all)["--all"]("Remove the cache too"));
+
+    std::filesystem::path const root = std::filesystem::temp_directory_path() / "dodo_parse_cache_test";
+    std::filesystem::remove_all(root);
+
+    dodo::ParseCache cache(cli, root);
+    dodo::Args const args({"build", "--jobs=8", "--levels=1 2 3"});
+    char const * const environment[] = {"APP_TARGET=tests"};
+    static auto const index = dodo::make_environment_index<1>(cli);
+    auto const values = index.scan(environment);
+
+    auto const parsed = cache.parse(args, dodo::value_sources(values));
+    REQUIRE(parsed);
+    REQUIRE(cache.misses == 1);
+    REQUIRE(checks == 1);
+
+    auto const cached = cache.parse(args, dodo::value_sources(values));
+    REQUIRE(cached);
+    REQUIRE(cache.hits == 1);
+    REQUIRE(checks == 1);
+    REQUIRE(cached->index() == 0);
+    REQUIRE(std::get<0>(*cached).jobs == 8);
+    REQUIRE(std::get<0>(*cached).target == "tests");
+    REQUIRE(std::get<0>(*cached).levels == std::vector<int>{1, 2, 3});
+
+    SECTION("Other arguments or environment are a miss")
+    {
+        char const * const other_environment[] = {"APP_TARGET=docs"};
+        auto const other_values = index.scan(other_environment);
+        auto const other = cache.parse(args, dodo::value_sources(other_values));
+        REQUIRE(other);
+        REQUIRE(cache.misses == 2);
+        REQUIRE(std::get<0>(*other).target == "docs");
+
+        auto const clean = cache.parse(dodo::Args({"clean", "--all"}));
+        REQUIRE(clean);
+        REQUIRE(cache.misses == 3);
+        REQUIRE(std::get<1>(*clean).all);
+    }
+    SECTION("Corrupted entries are a miss and are written again")
+    {
+        for (auto const & entry : std::filesystem::directory_iterator(root))
+        {
+            std::fstream file(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(-1, std::ios::end);
+            file.put('\x7F');
+        }
+
+        dodo::ParseCache fresh(cli, root);
+        auto const reparsed = fresh.parse(args, dodo::value_sources(values));
+        REQUIRE(reparsed);
+        REQUIRE(fresh.misses == 1);
+        REQUIRE(checks == 2);
+        REQUIRE(fresh.parse(args, dodo::value_sources(values)));
+        REQUIRE(fresh.hits == 1);
+    }
+    SECTION("Hits on an entry read from the same mapping")
+    {
+        auto const again = cache.parse(args, dodo::value_sources(values));
+        REQUIRE(cache.hits == 2);
+        REQUIRE(std::get<0>(*again).target.data() == std::get<0>(*cached).target.data());
+    }
+    SECTION("Entries of other builds are a miss")
+    {
+        STATIC_REQUIRE(dodo::parser_fingerprint(dodo_Flag(all)["--all"]("All"), "1.0") != dodo::parser_fingerprint(dodo_Flag(all)["--all"]("All"), "1.1"));
+
+        dodo::ParseCache next_build(cli, root, dodo::parser_fingerprint(cli, "1.1"));
+        REQUIRE(next_build.parse(args, dodo::value_sources(values)));
+        REQUIRE(next_build.misses == 1);
+        REQUIRE(checks == 2);
+    }
+    SECTION("Errors are not cached")
+    {
+        dodo::Args const wrong({"build", "--jobs=0"});
+        REQUIRE(!cache.parse(wrong));
+        REQUIRE(!cache.parse(wrong));
+        REQUIRE(cache.misses == 3);
+    }
+
+    checks = 0;
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Flat images of results are read in place from shared memory")
+{
+    constexpr auto workers = dodo_Opt(int, workers)["--workers"]("Number of workers").by_default(4);
+    constexpr auto listen = dodo_Opt(std::string, listen)["--listen"]("Address to listen on").by_default(std::string_view("0.0.0.0"));
+    constexpr auto ports = dodo_Opt(std::vector<int>, ports)["--ports"]("Ports to listen on").by_default(std::vector<int>());
+    constexpr auto hosts = dodo_Opt(std::vector<std::string>, hosts)["--hosts"]("Virtual hosts").by_default(std::vector<std::string>());
+    constexpr auto force = dodo_Flag(force)["--force"]("Stop without waiting");
+    auto const cli = dodo::Command("serve", "Start the server", workers | listen | ports | hosts) | dodo::Command("stop", "Stop the server", force);
+
+    auto const parsed = cli.parse(dodo::Args({"serve", "--workers=64", "--ports=80 443", "--hosts=a.example b.example"}));
+    REQUIRE(parsed);
+
+    std::string const image = dodo::write_flat_image(cli, *parsed);
+    std::optional<dodo::shared_memory> const memory = dodo::shared_memory::create(image);
+    REQUIRE(memory);
+
+    auto const view = dodo::flat_result_view<std::remove_cvref_t<decltype(cli)>>::from_bytes(cli, memory->bytes());
+    REQUIRE(view);
+    REQUIRE(view->has(workers));
+    REQUIRE(!view->has(force));
+    REQUIRE(view->get(workers) == 64);
+    REQUIRE(view->get(listen) == "0.0.0.0");
+    REQUIRE(view->get(ports).size() == 2);
+    REQUIRE(view->get(ports)[1] == 443);
+    REQUIRE(view->get(hosts).size() == 2);
+    REQUIRE(view->get(hosts)[1] == "b.example");
+
+    // Values point into the shared memory instead of being copied.
+    std::string_view const address = view->get(listen);
+    REQUIRE(address.data() >= memory->bytes().data());
+    REQUIRE(address.data() + address.size() <= memory->bytes().data() + memory->bytes().size());
+
+    SECTION("Options that are not in the parser are never parsed")
+    {
+        constexpr auto threads = dodo_Opt(int, threads)["--threads"]("Number of threads").by_default(1);
+        REQUIRE(!view->has(threads));
+        REQUIRE_THROWS_AS(view->get(threads), std::out_of_range);
+    }
+    SECTION("Images of other parsers or with slots out of bounds are rejected")
+    {
+        auto const other = dodo_Opt(int, workers)["--workers"]("Number of workers").by_default(4);
+        REQUIRE(!dodo::flat_result_view<std::remove_cvref_t<decltype(other)>>::from_bytes(other, memory->bytes()));
+
+        std::string truncated = image;
+        truncated.resize(truncated.size() - 1);
+        REQUIRE(!decltype(view)::value_type::from_bytes(cli, truncated));
+    }
+    SECTION("Images with bools that are neither true nor false are rejected")
+    {
+        auto const stop = cli.parse(dodo::Args({"stop", "--force"}));
+        REQUIRE(stop);
+        std::string corrupt = dodo::write_flat_image(cli, *stop);
+        REQUIRE(decltype(view)::value_type::from_bytes(cli, corrupt));
+
+        // The flag of stop is the fifth slot, after those of serve.
+        dodo::flat_slot slot;
+        std::memcpy(&slot, corrupt.data() + 32 + 4 * sizeof(dodo::flat_slot), sizeof(slot));
+        corrupt[slot.offset] = 2;
+        REQUIRE(!decltype(view)::value_type::from_bytes(cli, corrupt));
+    }
+}
+
+TEST_CASE("Profiles give options values with less precedence than the command line")
+{
+    static constexpr dodo::profile prod("prod", {{"threads", "32"}, {"log-level", "warn"}, {"cache", "true"}});
+    static constexpr dodo::profile debug("debug", {{"threads", "1"}, {"log-level", "trace"}});
+
+    static constexpr auto cli =
+        dodo_Opt(std::string_view, profile)["--profile"]("Preset of options").env("APP_PROFILE").by_default(std::string_view()).profiles(prod, debug)
+        | dodo_Opt(int, threads)["--threads"]("Number of worker threads").by_default(4)
+        | dodo_Opt(std::string_view, log_level)["--log-level"]("Least severe messages to log").by_default(std::string_view("info"))
+        | dodo_Flag(cache)["--cache"]("Cache results");
+    static_assert(dodo::profile_error(cli).empty());
+
+    SECTION("No profile")
+    {
+        auto const parsed = cli.parse(dodo::Args({"--threads=8"}));
+        REQUIRE(parsed);
+        REQUIRE(parsed->threads == 8);
+        REQUIRE(parsed->log_level == "info");
+        REQUIRE(!parsed->cache);
+    }
+    SECTION("Explicit options win over the profile")
+    {
+        std::vector<dodo::value_origin> origins;
+        dodo::value_sources sources;
+        sources.origins = &origins;
+
+        auto const parsed = cli.parse(dodo::Args({"--threads=8", "--profile=prod"}), sources);
+        REQUIRE(parsed);
+        REQUIRE(parsed->profile == "prod");
+        REQUIRE(parsed->threads == 8);
+        REQUIRE(parsed->log_level == "warn");
+        REQUIRE(parsed->cache);
+        REQUIRE(origins[2].kind == dodo::value_origin_kind::profile);
+        REQUIRE(origins[2].source == "prod");
+    }
+    SECTION("The profile may come from the environment")
+    {
+        static constexpr auto environment = dodo_EnvironmentIndex(cli);
+        char const * const entries[] = {"APP_PROFILE=debug"};
+        auto const values = environment.scan(entries);
+
+        auto const parsed = cli.parse(dodo::ArgsView(std::span<std::string_view const>()), dodo::value_sources(values));
+        REQUIRE(parsed);
+        REQUIRE(parsed->threads == 1);
+        REQUIRE(parsed->log_level == "trace");
+    }
+    SECTION("Unknown profiles are an error")
+    {
+        auto const parsed = cli.parse(dodo::Args({"--profile=bench"}));
+        REQUIRE(!parsed);
+        REQUIRE(parsed.error() == "Unknown profile \"bench\". The profiles of --profile are: prod debug");
+    }
+    SECTION("Profiles are checked at compile time")
+    {
+        static constexpr dodo::profile typo("typo", {{"thread", "2"}});
+        static constexpr dodo::profile wrong_type("wrong", {{"threads", "many"}});
+        constexpr auto threads = dodo_Opt(int, threads)["--threads"]("Number of worker threads").by_default(4);
+
+        static_assert(dodo::profile_error(dodo_Opt(std::string_view, profile)["--profile"]("Preset").profiles(typo) | threads) ==
+            "A profile sets an option that is not in the parser of options of the profile option");
+        static_assert(dodo::profile_error(dodo_Opt(std::string_view, profile)["--profile"]("Preset").profiles(wrong_type) | threads) ==
+            "A profile sets an option to a value that does not convert to its type");
+        static_assert(dodo::profile_error(dodo_Opt(std::string_view, profile)["--profile"]("Preset").profiles(prod, prod) | threads) ==
+            "Two profiles have the same name");
+
+        // Floating point values are checked with the same syntax as std::from_chars.
+        static constexpr dodo::profile special("special", {{"ratio", "-Infinity"}, {"limit", "nan(quiet_1)"}, {"scale", "1.5e-3"}});
+        static constexpr dodo::profile hex("hex", {{"ratio", "0x1p3"}});
+        constexpr auto ratios = dodo_Opt(double, ratio)["--ratio"]("Ratio").by_default(1.0)
+            | dodo_Opt(double, limit)["--limit"]("Limit").by_default(1.0)
+            | dodo_Opt(float, scale)["--scale"]("Scale").by_default(1.0f);
+        static constexpr auto special_cli = dodo_Opt(std::string_view, profile)["--profile"]("Preset").profiles(special) | ratios;
+        static_assert(dodo::profile_error(special_cli).empty());
+        static_assert(!dodo::profile_error(dodo_Opt(std::string_view, profile)["--profile"]("Preset").profiles(hex) | ratios).empty());
+
+        auto const parsed = special_cli.parse(dodo::Args({"--profile=special"}));
+        REQUIRE(parsed);
+        REQUIRE(std::isinf(parsed->ratio));
+        REQUIRE(std::isnan(parsed->limit));
+        REQUIRE(!special_cli.parse(dodo::Args({"--ratio=0x1p3"})));
+    }
+}
+
+TEST_CASE("Lazy default values are only computed when they are needed")
+{
+    static int computations = 0;
+    static int derivations = 0;
+    computations = 0;
+    derivations = 0;
+
+    struct no_default
+    {
+        explicit no_default(int) {}
+    };
+
+    constexpr auto cli =
+        dodo_Opt(dodo::lazy<int>, threads)["--threads"]("Number of worker threads").by_default_lazy([]() { ++computations; return 16; })
+        | dodo_Opt(int, workers)["--workers"]("Number of workers").by_default_lazy([](auto const & options) { return *options.threads * 2; })
+        | dodo_Opt(dodo::lazy<int>, queue)["--queue"]("Size of the queue").by_default_lazy([](auto const & options) { ++derivations; return options.workers * 4; })
+        | dodo_Opt(no_default, unused)["--unused"]("Option with no default constructor").custom_parser([](std::string_view) { return std::optional(no_default(0)); })
+            .by_default_lazy([]() { return no_default(1); });
+
+    SECTION("Options that are given are not computed")
+    {
+        auto const parsed = cli.parse(dodo::Args({"--threads=3"}));
+        REQUIRE(parsed);
+        REQUIRE(*parsed->threads == 3);
+        REQUIRE(parsed->workers == 6);
+        REQUIRE(computations == 0);
+    }
+    SECTION("Deferred values are computed once, the first time they are read")
+    {
+        auto const parsed = cli.parse(dodo::Args({"--workers=5"}));
+        REQUIRE(parsed);
+        REQUIRE(parsed->workers == 5);
+        REQUIRE(!parsed->threads.is_computed());
+        REQUIRE(computations == 0);
+
+        auto const copy = parsed->threads;
+        REQUIRE(*parsed->threads == 16);
+        REQUIRE(*copy == 16);
+        REQUIRE(copy.is_computed());
+        REQUIRE(computations == 1);
+    }
+    SECTION("Derived values are computed from the other options")
+    {
+        auto const parsed = cli.parse(dodo::ArgsView(std::span<std::string_view const>()));
+        REQUIRE(parsed);
+        REQUIRE(parsed->workers == 32);
+        REQUIRE(computations == 1);
+        REQUIRE(derivations == 0);
+    }
+    SECTION("Derived values that are lazy are derived once, the first time they are read")
+    {
+        auto parsed = cli.parse(dodo::Args({"--threads=2"}));
+        REQUIRE(parsed);
+        REQUIRE(!parsed->queue.is_computed());
+
+        auto const moved = std::move(*parsed);
+        REQUIRE(*moved.queue == 16);
+        REQUIRE(*moved.queue == 16);
+        REQUIRE(derivations == 1);
+        REQUIRE(computations == 0);
+        REQUIRE(cli.to_string().find("By default: computed") != std::string::npos);
+    }
+    SECTION("Reading a lazy derived value while deriving another fails the parse")
+    {
+        constexpr auto misordered =
+            dodo_Opt(dodo::lazy<int>, queue)["--queue"]("Size of the queue").by_default_lazy([](auto const &) { return 4; })
+            | dodo_Opt(int, workers)["--workers"]("Number of workers").by_default_lazy([](auto const & options) { return *options.queue; });
+
+        REQUIRE(!misordered.parse(dodo::ArgsView(std::span<std::string_view const>())));
+        REQUIRE(misordered.parse(dodo::Args({"--workers=2"})));
+    }
+}
+
 TEST_CASE("Implicit value allows for setting a value implicitly to an option if the option is mentioned but no value is assigned")
 {
     constexpr auto cli = dodo_Opt(bool, some_flag)["--flag"]
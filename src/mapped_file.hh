@@ -0,0 +1,90 @@
+#pragma once
+
+#include "platform.hh"
+#include <cstddef>
+#include <span>
+
+namespace dodo
+{
+
+    // Read only view of a whole file mapped into memory. Empty if the file could not be opened or mapped.
+    struct mapped_file
+    {
+        explicit mapped_file(char const * path) noexcept;
+        ~mapped_file();
+
+        mapped_file(mapped_file const &) = delete;
+        mapped_file & operator = (mapped_file const &) = delete;
+
+        std::span<char const> bytes() const noexcept { return std::span<char const>(data, size); }
+        explicit operator bool() const noexcept { return data != nullptr; }
+
+    private:
+        char const * data = nullptr;
+        size_t size = 0;
+    #if defined(_WIN32)
+        detail::win32::handle file = detail::win32::invalid_handle_value;
+        detail::win32::handle mapping = nullptr;
+    #endif
+    };
+
+#if defined(_WIN32)
+    inline mapped_file::mapped_file(char const * path) noexcept
+    {
+        using namespace detail::win32;
+        file = CreateFileA(path, generic_read, file_share_read, nullptr, open_existing, file_attribute_normal, nullptr);
+        if (file == invalid_handle_value)
+            return;
+
+        long long file_size = 0;
+        if (!detail::win32::file_size(file, file_size) || file_size == 0)
+            return;
+
+        mapping = CreateFileMappingA(file, nullptr, page_readonly, 0, 0, nullptr);
+        if (mapping == nullptr)
+            return;
+
+        data = static_cast<char const *>(MapViewOfFile(mapping, file_map_read, 0, 0, 0));
+        if (data != nullptr)
+            size = size_t(file_size);
+    }
+
+    inline mapped_file::~mapped_file()
+    {
+        if (data != nullptr)
+            detail::win32::UnmapViewOfFile(data);
+        if (mapping != nullptr)
+            detail::win32::CloseHandle(mapping);
+        if (file != detail::win32::invalid_handle_value)
+            detail::win32::CloseHandle(file);
+    }
+#else
+    inline mapped_file::mapped_file(char const * path) noexcept
+    {
+        int const file = ::open(path, O_RDONLY);
+        if (file < 0)
+            return;
+
+        struct stat status = {};
+        if (::fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            void * const mapping = ::mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED)
+            {
+                data = static_cast<char const *>(mapping);
+                size = size_t(status.st_size);
+            }
+        }
+
+        // The mapping stays valid after the file is closed.
+        ::close(file);
+    }
+
+    inline mapped_file::~mapped_file()
+    {
+        if (data != nullptr)
+            ::munmap(const_cast<char *>(data), size);
+    }
+#endif
+
+} // namespace dodo
@@ -0,0 +1,485 @@
+#pragma once
+
+#include "dodo.hh"
+#include "mapped_file.hh"
+#include "platform.hh"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace dodo
+{
+
+    // How values of type T are stored in a parse cache. encode appends the value to the bytes of the entry, and decode reads it back
+    // from the front of the bytes, which it advances, or returns false if they are not a value of the type. Decoded values may point
+    // into the bytes, which stay mapped for as long as the cache lives.
+    // Arithmetic types, enums, strings, string views and optionals and vectors of them are stored with no conversion. Other types
+    // that can be parsed and printed with parse_traits are stored as text and parsed again when they are loaded.
+    template <typename T>
+    struct cache_traits;
+
+    template <typename T>
+    concept TraitCacheable = requires(T const & t, T & value, std::string & out, std::string_view & bytes) {
+        cache_traits<T>::encode(out, t);
+        {cache_traits<T>::decode(bytes, value)} -> std::same_as<bool>;
+    };
+
+    namespace detail
+    {
+        // Numbers in a cache are in the byte order of the machine that wrote it, since a cache is only read where it is written.
+        template <typename T>
+        void append_cached_bytes(std::string & out, T const & value)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.append(bytes, sizeof(T));
+        }
+
+        template <typename T>
+        bool read_cached_bytes(std::string_view & bytes, T & value) noexcept
+        {
+            if (bytes.size() < sizeof(T))
+                return false;
+            std::memcpy(&value, bytes.data(), sizeof(T));
+            bytes.remove_prefix(sizeof(T));
+            return true;
+        }
+
+        inline void append_cached_text(std::string & out, std::string_view text)
+        {
+            append_cached_bytes(out, uint32_t(text.size()));
+            out.append(text);
+        }
+
+        inline bool read_cached_text(std::string_view & bytes, std::string_view & text) noexcept
+        {
+            uint32_t size;
+            if (!read_cached_bytes(bytes, size) || bytes.size() < size)
+                return false;
+            text = bytes.substr(0, size);
+            bytes.remove_prefix(size);
+            return true;
+        }
+    }
+
+    template <typename T> requires(std::is_arithmetic_v<T> || std::is_enum_v<T>)
+    struct cache_traits<T>
+    {
+        static void encode(std::string & out, T value) { detail::append_cached_bytes(out, value); }
+        static bool decode(std::string_view & bytes, T & value) noexcept { return detail::read_cached_bytes(bytes, value); }
+    };
+
+    template <>
+    struct cache_traits<std::string_view>
+    {
+        static void encode(std::string & out, std::string_view value) { detail::append_cached_text(out, value); }
+        static bool decode(std::string_view & bytes, std::string_view & value) noexcept { return detail::read_cached_text(bytes, value); }
+    };
+
+    template <>
+    struct cache_traits<std::string>
+    {
+        static void encode(std::string & out, std::string const & value) { detail::append_cached_text(out, value); }
+
+        static bool decode(std::string_view & bytes, std::string & value)
+        {
+            std::string_view text;
+            if (!detail::read_cached_text(bytes, text))
+                return false;
+            value = text;
+            return true;
+        }
+    };
+
+    // Stored as text with the parse traits of the type.
+    template <typename T> requires(!std::is_arithmetic_v<T> && !std::is_enum_v<T> && TraitPrintable<T> && requires(std::string_view text) {
+        {parse_traits<T>::parse(text)} -> std::same_as<std::optional<T>>; })
+    struct cache_traits<T>
+    {
+        static void encode(std::string & out, T const & value) { detail::append_cached_text(out, std::string_view(dodo::to_string(value))); }
+
+        static bool decode(std::string_view & bytes, T & value)
+        {
+            std::string_view text;
+            if (!detail::read_cached_text(bytes, text))
+                return false;
+            std::optional<T> parsed = parse_traits<T>::parse(text);
+            if (!parsed)
+                return false;
+            value = std::move(*parsed);
+            return true;
+        }
+    };
+
+    template <TraitCacheable T>
+    struct cache_traits<std::optional<T>>
+    {
+        static void encode(std::string & out, std::optional<T> const & value)
+        {
+            out.push_back(value ? 1 : 0);
+            if (value)
+                cache_traits<T>::encode(out, *value);
+        }
+
+        static bool decode(std::string_view & bytes, std::optional<T> & value)
+        {
+            if (bytes.empty() || uint8_t(bytes[0]) > 1)
+                return false;
+            bool const has_value = bytes[0] == 1;
+            bytes.remove_prefix(1);
+
+            if (!has_value)
+            {
+                value.reset();
+                return true;
+            }
+            return cache_traits<T>::decode(bytes, value.emplace());
+        }
+    };
+
+    // Takes precedence over the parse traits of vectors, so elements are stored with no conversion.
+    template <TraitCacheable T, typename Alloc>
+    struct cache_traits<std::vector<T, Alloc>>
+    {
+        static void encode(std::string & out, std::vector<T, Alloc> const & value)
+        {
+            detail::append_cached_bytes(out, uint32_t(value.size()));
+            for (T const & element : value)
+                cache_traits<T>::encode(out, element);
+        }
+
+        static bool decode(std::string_view & bytes, std::vector<T, Alloc> & value)
+        {
+            uint32_t size;
+            if (!detail::read_cached_bytes(bytes, size) || bytes.size() < size)
+                return false;
+
+            value.clear();
+            value.reserve(size);
+            for (uint32_t i = 0; i < size; ++i)
+                if (!cache_traits<T>::decode(bytes, value.emplace_back()))
+                    return false;
+            return true;
+        }
+    };
+
+    namespace detail
+    {
+        // Appends the values of the result of the parser, in the order of the options and arguments of the parser. Results of commands
+        // start with the index of the command that was chosen, and only hold the values of that command.
+        struct cached_result_encoder : parser_visitor<cached_result_encoder>
+        {
+            template <typename P, typename R>
+            void visit_commands(P const & commands, R result)
+            {
+                if (result == nullptr)
+                    return;
+                append_cached_bytes(out, uint32_t(result->index()));
+                parser_visitor<cached_result_encoder>::visit_commands(commands, result);
+            }
+
+            template <typename P, typename R>
+            void visit_option(P const & option, R result) { encode(option, result); }
+
+            template <typename P, typename R>
+            void visit_argument(P const & argument, R result) { encode(argument, result); }
+
+            template <typename P, typename R>
+            void visit_other(P const &, R)
+            {
+                static_assert(sizeof(P) == 0, "Results of this parser can't be cached");
+            }
+
+            template <typename P, typename R>
+            void encode(P const &, R result)
+            {
+                using value_type = typename P::value_type;
+                static_assert(TraitCacheable<value_type>, "Values of this type can't be cached. Specialize cache_traits for it");
+                if (result != nullptr)
+                    cache_traits<value_type>::encode(out, static_cast<typename P::parse_result_type const &>(*result)._get());
+            }
+
+            std::string & out;
+        };
+
+        template <typename P, typename Result>
+        void encode_cached_result(P const & parser, Result const & result, std::string & out)
+        {
+            cached_result_encoder encoder{{}, out};
+            visit_parser(parser, &result, encoder);
+        }
+
+        // Reads back what encode_cached_result wrote. decoded is false if the bytes are not a result of the parser.
+        struct cached_result_decoder : parser_visitor<cached_result_decoder>
+        {
+            template <typename P, typename R>
+            void visit_commands(P const & commands, R result)
+            {
+                if (result == nullptr || !decoded)
+                    return;
+
+                uint32_t index;
+                decoded = read_cached_bytes(bytes, index) && index < std::variant_size_v<std::remove_pointer_t<R>>;
+                if (!decoded)
+                    return;
+
+                // The alternative may be that of an implicit command, which is decoded after the commands.
+                [&]<size_t ... I>(std::index_sequence<I...>)
+                {
+                    ((index == I ? void(result->template emplace<I>()) : void()), ...);
+                }(std::make_index_sequence<std::variant_size_v<std::remove_pointer_t<R>>>());
+                parser_visitor<cached_result_decoder>::visit_commands(commands, result);
+            }
+
+            template <typename P, typename R>
+            void visit_option(P const & option, R result) { decode(option, result); }
+
+            template <typename P, typename R>
+            void visit_argument(P const & argument, R result) { decode(argument, result); }
+
+            template <typename P, typename R>
+            void visit_other(P const &, R)
+            {
+                static_assert(sizeof(P) == 0, "Results of this parser can't be cached");
+            }
+
+            template <typename P, typename R>
+            void decode(P const &, R result)
+            {
+                if (result == nullptr || !decoded)
+                    return;
+
+                using value_type = typename P::value_type;
+                value_type value{};
+                decoded = cache_traits<value_type>::decode(bytes, value);
+                if (decoded)
+                    static_cast<typename P::parse_result_type &>(*result) = typename P::parse_result_type{std::move(value)};
+            }
+
+            std::string_view & bytes;
+            bool decoded = true;
+        };
+
+        template <typename P, typename Result>
+        bool decode_cached_result(P const & parser, Result & result, std::string_view & bytes)
+        {
+            cached_result_decoder decoder{{}, bytes};
+            visit_parser(parser, &result, decoder);
+            return decoder.decoded;
+        }
+
+        constexpr std::string_view parse_cache_magic = "dodopc01";
+        constexpr size_t parse_cache_header_size = 24;
+
+        // Suffix of the temporary file an entry is written to, which is unique among the processes and threads that share the directory.
+        inline std::string unique_temporary_suffix()
+        {
+            static std::atomic<uint64_t> counter = 0;
+        #if defined(_WIN32)
+            uint64_t const process = detail::win32::GetCurrentProcessId();
+        #else
+            uint64_t const process = uint64_t(::getpid());
+        #endif
+            return "." + std::to_string(process) + "." + std::to_string(counter.fetch_add(1, std::memory_order_relaxed)) + "." +
+                std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+        }
+    }
+
+    // Opt in cache of parse results on disk, for programs that are run many times with the same arguments, such as by a build system.
+    // Entries are keyed by the fingerprint of the parser, the arguments, the values of the environment variables the options read and the
+    // pairs of the config file, and hold the parsed values in binary. A hit maps the entry into memory and reads the values from it with no
+    // tokenizing, matching, conversion or checks. Entries are checked when they are loaded, and any that is not exactly what this parser
+    // would write for the same key is treated as a miss and written again.
+    // Checks are not run again for results that come from the cache, so checks that depend on the state of the system, such as whether
+    // a file exists, only hold when the entry was written. Parses that record the origins of values always parse.
+    // The fingerprint only describes the options of the parser, not the code of its custom parsers and checks. Programs whose options
+    // have them should give a fingerprint with a build ID, made with parser_fingerprint(parser, build_id), so that entries written by
+    // other builds are not read.
+    // The file of each entry is named after the hash of its key and is written to a temporary file and renamed, so processes that share
+    // the directory never see partial entries. Each entry is mapped once, and hits on it read from the same mapping.
+    // Entry files are:
+    //   header:  "dodopc01", size of the key, size of the values, hash of the key and values
+    //   key:     fingerprint, arguments, environment variables and config pairs
+    //   values:  the values of the result, in the order of the options and arguments of the parser, as cache_traits stores them
+    template <Parser P>
+    struct ParseCache
+    {
+        using parse_result_type = typename P::parse_result_type;
+
+        ParseCache(P parser_, std::filesystem::path directory_) : ParseCache(parser_, std::move(directory_), parser_fingerprint(parser_)) {}
+        ParseCache(P parser_, std::filesystem::path directory_, uint64_t fingerprint_)
+            : parser(std::move(parser_))
+            , directory(std::move(directory_))
+            , fingerprint(fingerprint_)
+        {}
+
+        // Loads the result from the cache if the same arguments, environment and config were parsed before. Otherwise parses them and
+        // writes the result to the cache if it succeeded. Errors are not cached. Values loaded from the cache may point into the mapped
+        // entry, which stays mapped for as long as the cache lives.
+        expected<parse_result_type, std::string> parse(ArgsView args, value_sources const & sources = {});
+
+        size_t hits = 0;
+        size_t misses = 0;
+
+    private:
+        std::string make_key(ArgsView args, value_sources const & sources) const;
+        std::optional<parse_result_type> load(std::filesystem::path const & path, std::string_view key);
+        void store(std::filesystem::path const & path, std::string_view key, parse_result_type const & result) const;
+
+        P parser;
+        std::filesystem::path directory;
+        uint64_t fingerprint;
+        std::map<std::string, mapped_file, std::less<>> entries;   // By path. Only entries that values may point into are kept.
+    };
+
+    template <Parser P>
+    expected<typename ParseCache<P>::parse_result_type, std::string> ParseCache<P>::parse(ArgsView args, value_sources const & sources)
+    {
+        if (sources.origins != nullptr)
+            return parser.parse(args, sources);
+
+        std::string const key = make_key(args, sources);
+
+        char name[17];
+        uint64_t const hash = string_hash(key, 0);
+        for (int i = 0; i < 16; ++i)
+            name[i] = "0123456789abcdef"[(hash >> (60 - 4 * i)) & 0xF];
+        name[16] = '\0';
+        std::filesystem::path const path = directory / name;
+
+        if (std::optional<parse_result_type> cached = load(path, key))
+        {
+            ++hits;
+            return std::move(*cached);
+        }
+
+        ++misses;
+        auto parsed = parser.parse(args, sources);
+        if (parsed)
+            store(path, key, *parsed);
+        return parsed;
+    }
+
+    template <Parser P>
+    std::string ParseCache<P>::make_key(ArgsView args, value_sources const & sources) const
+    {
+        std::string key;
+        detail::append_cached_bytes(key, fingerprint);
+
+        detail::append_cached_bytes(key, uint32_t(args.size()));
+        for (std::string_view const arg : args)
+            detail::append_cached_text(key, arg);
+
+        std::vector<std::string_view> names;
+        detail::for_each_environment_variable(parser, [&](std::string_view name) { names.push_back(name); });
+        std::vector<std::optional<std::string_view>> values;
+        if (sources.environment.is_indexed())
+            for (std::string_view const name : names)
+                values.push_back(sources.environment.find(name));
+        else
+            values = detail::find_in_process_environment(names);
+
+        for (std::optional<std::string_view> const & value : values)
+        {
+            key.push_back(value ? 1 : 0);
+            if (value)
+                detail::append_cached_text(key, *value);
+        }
+
+        detail::append_cached_text(key, sources.section);
+        detail::append_cached_bytes(key, uint32_t(sources.config != nullptr ? sources.config->entries().size() : 0));
+        if (sources.config != nullptr)
+        {
+            for (config_entry const & entry : sources.config->entries())
+            {
+                detail::append_cached_text(key, entry.section);
+                detail::append_cached_text(key, entry.key);
+                detail::append_cached_text(key, entry.value);
+            }
+        }
+
+        return key;
+    }
+
+    template <Parser P>
+    auto ParseCache<P>::load(std::filesystem::path const & path, std::string_view key) -> std::optional<parse_result_type>
+    {
+        std::string const name = path.string();
+        auto mapped = entries.find(name);
+        bool const mapped_before = mapped != entries.end();
+        if (!mapped_before)
+            mapped = entries.try_emplace(name, name.c_str()).first;
+
+        mapped_file const & entry = mapped->second;
+        std::string_view bytes(entry.bytes().data(), entry.bytes().size());
+
+        std::optional<parse_result_type> result;
+        if (bytes.size() >= detail::parse_cache_header_size && bytes.substr(0, 8) == detail::parse_cache_magic)
+        {
+            uint32_t key_size, values_size;
+            uint64_t hash;
+            std::memcpy(&key_size, bytes.data() + 8, sizeof(key_size));
+            std::memcpy(&values_size, bytes.data() + 12, sizeof(values_size));
+            std::memcpy(&hash, bytes.data() + 16, sizeof(hash));
+            bytes.remove_prefix(detail::parse_cache_header_size);
+
+            if (bytes.size() == uint64_t(key_size) + values_size && string_hash(bytes, 0) == hash && bytes.substr(0, key_size) == key)
+            {
+                bytes.remove_prefix(key_size);
+                result.emplace();
+                if (!detail::decode_cached_result(parser, *result, bytes) || !bytes.empty())
+                    result.reset();
+            }
+        }
+
+        // Entries are only kept mapped if they decoded, which they always do again, since their key decides what they hold.
+        if (!result && !mapped_before)
+            entries.erase(mapped);
+        return result;
+    }
+
+    template <Parser P>
+    void ParseCache<P>::store(std::filesystem::path const & path, std::string_view key, parse_result_type const & result) const
+    {
+        std::string values;
+        detail::encode_cached_result(parser, result, values);
+
+        std::string contents(detail::parse_cache_magic);
+        detail::append_cached_bytes(contents, uint32_t(key.size()));
+        detail::append_cached_bytes(contents, uint32_t(values.size()));
+        detail::append_cached_bytes(contents, uint64_t(0));
+        contents += key;
+        contents += values;
+        uint64_t const hash = string_hash(std::string_view(contents).substr(detail::parse_cache_header_size), 0);
+        std::memcpy(contents.data() + 16, &hash, sizeof(hash));
+
+        // The cache is an optimization, so failing to write to it is not an error.
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        std::filesystem::path temporary = path;
+        temporary += detail::unique_temporary_suffix();
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            file.write(contents.data(), std::streamsize(contents.size()));
+            if (!file.flush())
+                error = std::make_error_code(std::errc::io_error);
+        }
+        if (!error)
+            std::filesystem::rename(temporary, path, error);
+        if (error)
+            std::filesystem::remove(temporary, error);
+    }
+
+} // namespace dodo
@@ -1,9 +1,15 @@
 #pragma once
 
+#include "sink.hh"
 #include <string_view>
+#include <algorithm>
+#include <bit>
 #include <charconv>
+#include <cstdint>
 #include <string>
 #include <optional>
+#include <span>
+#include <type_traits>
 #include <vector>
 
 namespace dodo
@@ -21,6 +27,215 @@ namespace dodo
 		return parse_traits<T>::to_string(t);
 	}
 
+	// Types whose parse traits can write them to a sink with a static member function write(sink, value), which can be constexpr.
+	template <typename T>
+	concept TraitWritable = requires(T const & t, counting_sink & sink) { parse_traits<T>::write(sink, t); };
+
+	// Writes the same text as dodo::to_string. Types that are not TraitWritable are converted to a string first, which can't be done
+	// at compile time.
+	template <Sink S, typename T>
+	constexpr void write_value(S & sink, T const & t)
+	{
+		if constexpr (TraitWritable<T>)
+			parse_traits<T>::write(sink, t);
+		else
+			sink.write(dodo::to_string(t));
+	}
+
+	// Types whose parse traits list every text they accept in a static member array values, such as "true" and "false" for bool.
+	// Shell completion offers them as candidates. Parse traits of enums can list the names of their enumerators.
+	template <typename T>
+	concept TraitWithValues = requires { std::span<std::string_view const>(parse_traits<T>::values); };
+
+	namespace detail
+	{
+		template <Sink S, std::integral T>
+		constexpr void write_integer(S & sink, T x) noexcept
+		{
+			char buffer[24];
+			size_t begin = sizeof(buffer);
+
+			// Digits are taken from the absolute value as unsigned, which is well defined even for the minimum value.
+			auto absolute_value = static_cast<std::make_unsigned_t<T>>(x);
+			if (x < 0)
+				absolute_value = static_cast<std::make_unsigned_t<T>>(0 - absolute_value);
+
+			do
+			{
+				buffer[--begin] = char('0' + absolute_value % 10);
+				absolute_value /= 10;
+			} while (absolute_value != 0);
+
+			if (x < 0)
+				buffer[--begin] = '-';
+
+			sink.write(std::string_view(buffer + begin, sizeof(buffer) - begin));
+		}
+
+		// Unsigned integer big enough to hold any double times 10^6, for formatting doubles exactly at compile time.
+		struct fixed_big_uint
+		{
+			static constexpr size_t max_limbs = 34;
+
+			constexpr explicit fixed_big_uint(uint64_t x) noexcept
+			{
+				for (; x != 0; x >>= 32)
+					limbs[size++] = uint32_t(x);
+			}
+
+			constexpr bool is_zero() const noexcept { return size == 0; }
+
+			constexpr bool bit(size_t index) const noexcept
+			{
+				return index / 32 < size && ((limbs[index / 32] >> (index % 32)) & 1) != 0;
+			}
+
+			constexpr bool any_bit_below(size_t index) const noexcept
+			{
+				for (size_t i = 0; i < index && i < size * 32; ++i)
+					if (bit(i))
+						return true;
+				return false;
+			}
+
+			constexpr void multiply(uint32_t factor) noexcept
+			{
+				uint64_t carry = 0;
+				for (size_t i = 0; i < size; ++i)
+				{
+					uint64_t const product = uint64_t(limbs[i]) * factor + carry;
+					limbs[i] = uint32_t(product);
+					carry = product >> 32;
+				}
+				if (carry != 0)
+					limbs[size++] = uint32_t(carry);
+			}
+
+			constexpr void add_one() noexcept
+			{
+				for (size_t i = 0; i < size; ++i)
+					if (++limbs[i] != 0)
+						return;
+				limbs[size++] = 1;
+			}
+
+			// Returns the remainder.
+			constexpr uint32_t divide(uint32_t divisor) noexcept
+			{
+				uint64_t remainder = 0;
+				for (size_t i = size; i-- > 0; )
+				{
+					uint64_t const current = (remainder << 32) | limbs[i];
+					limbs[i] = uint32_t(current / divisor);
+					remainder = current % divisor;
+				}
+				trim();
+				return uint32_t(remainder);
+			}
+
+			constexpr void shift_left(size_t bits) noexcept
+			{
+				size_t const limb_shift = bits / 32;
+				size_t const bit_shift = bits % 32;
+
+				uint32_t shifted[max_limbs] = {};
+				for (size_t i = 0; i < size && i + limb_shift < max_limbs; ++i)
+				{
+					uint64_t const value = uint64_t(limbs[i]) << bit_shift;
+					shifted[i + limb_shift] |= uint32_t(value);
+					if (i + limb_shift + 1 < max_limbs)
+						shifted[i + limb_shift + 1] |= uint32_t(value >> 32);
+				}
+
+				size = std::min(size + limb_shift + 1, max_limbs);
+				for (size_t i = 0; i < max_limbs; ++i)
+					limbs[i] = shifted[i];
+				trim();
+			}
+
+			constexpr void shift_right(size_t bits) noexcept
+			{
+				size_t const limb_shift = bits / 32;
+				size_t const bit_shift = bits % 32;
+
+				for (size_t i = 0; i < size; ++i)
+				{
+					size_t const source = i + limb_shift;
+					uint32_t low = source < size ? limbs[source] >> bit_shift : 0;
+					if (bit_shift != 0 && source + 1 < size)
+						low |= limbs[source + 1] << (32 - bit_shift);
+					limbs[i] = low;
+				}
+				trim();
+			}
+
+			uint32_t limbs[max_limbs] = {};
+			size_t size = 0;
+
+		private:
+			constexpr void trim() noexcept
+			{
+				while (size > 0 && limbs[size - 1] == 0)
+					--size;
+			}
+		};
+
+		// Writes the same text as printf("%f"), which is what std::to_string uses for floating point numbers. The decimal expansion is
+		// computed exactly and rounded to nearest with ties to even, as printf does.
+		template <Sink S>
+		constexpr void write_fixed(S & sink, double x) noexcept
+		{
+			uint64_t const bits = std::bit_cast<uint64_t>(x);
+			bool const negative = (bits >> 63) != 0;
+			uint32_t const biased_exponent = uint32_t(bits >> 52) & 0x7FF;
+			uint64_t const fraction = bits & ((uint64_t(1) << 52) - 1);
+
+			if (negative)
+				sink.write("-");
+
+			if (biased_exponent == 0x7FF)
+			{
+				sink.write(fraction == 0 ? "inf" : "nan");
+				return;
+			}
+
+			uint64_t const mantissa = biased_exponent == 0 ? fraction : fraction | (uint64_t(1) << 52);
+			int const exponent = (biased_exponent == 0 ? 1 : int(biased_exponent)) - 1075;
+
+			fixed_big_uint scaled(mantissa);
+			scaled.multiply(1'000'000);
+			if (exponent >= 0)
+			{
+				scaled.shift_left(size_t(exponent));
+			}
+			else
+			{
+				size_t const shift = size_t(-exponent);
+				bool const half = scaled.bit(shift - 1);
+				bool const sticky = scaled.any_bit_below(shift - 1);
+				scaled.shift_right(shift);
+				if (half && (sticky || scaled.bit(0)))
+					scaled.add_one();
+			}
+
+			constexpr size_t decimals = 6;
+			char digits[330] = {};
+			size_t digit_count = 0;
+			while (!scaled.is_zero() || digit_count <= decimals)
+				digits[digit_count++] = char('0' + scaled.divide(10));
+
+			char text[331] = {};
+			size_t text_size = 0;
+			for (size_t i = digit_count; i-- > 0; )
+			{
+				text[text_size++] = digits[i];
+				if (i == decimals)
+					text[text_size++] = '.';
+			}
+			sink.write(std::string_view(text, text_size));
+		}
+	}
+
 	template <typename T>
 	struct charconv_to_string_parse_traits
 	{
@@ -37,6 +252,15 @@ namespace dodo
 		{
 			return std::to_string(x);
 		}
+
+		template <Sink S>
+		static constexpr void write(S & sink, T x) noexcept requires(std::is_integral_v<T> || std::is_same_v<T, float> || std::is_same_v<T, double>)
+		{
+			if constexpr (std::is_integral_v<T>)
+				detail::write_integer(sink, x);
+			else
+				detail::write_fixed(sink, double(x));
+		}
 	};
 
 	template <> struct parse_traits<int16_t> : public charconv_to_string_parse_traits<int16_t> {};
@@ -52,6 +276,8 @@ namespace dodo
 	template <>
 	struct parse_traits<bool>
 	{
+		static constexpr std::string_view values[] = {"true", "false"};
+
 		static constexpr std::optional<bool> parse(std::string_view text) noexcept
 		{
 			if (text == "true")
@@ -66,6 +292,12 @@ namespace dodo
 		{
 			return x ? "true" : "false";
 		}
+
+		template <Sink S>
+		static constexpr void write(S & sink, bool x) noexcept
+		{
+			sink.write(x ? "true" : "false");
+		}
 	};
 
 	template <>
@@ -80,6 +312,12 @@ namespace dodo
 		{
 			return s;
 		}
+
+		template <Sink S>
+		static constexpr void write(S & sink, std::string const & s) noexcept
+		{
+			sink.write(s);
+		}
 	};
 
 	template <>
@@ -94,6 +332,12 @@ namespace dodo
 		{
 			return std::string(s);
 		}
+
+		template <Sink S>
+		static constexpr void write(S & sink, std::string_view s) noexcept
+		{
+			sink.write(s);
+		}
 	};
 
 	template <typename T, typename Alloc>
@@ -134,6 +378,17 @@ namespace dodo
 
 			return result;
 		}
+
+		template <Sink S>
+		static constexpr void write(S & sink, std::vector<T, Alloc> const & v)
+		{
+			for (size_t i = 0; i < v.size(); ++i)
+			{
+				if (i > 0)
+					sink.write(" ");
+				write_value(sink, v[i]);
+			}
+		}
 	};
 
 } // namespace dodo
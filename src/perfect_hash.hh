@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace dodo
+{
+
+    constexpr uint64_t string_hash(std::string_view text, uint64_t seed) noexcept
+    {
+        // FNV-1a with the seed mixed into the offset basis.
+        uint64_t hash = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+        for (char const c : text)
+        {
+            hash ^= uint8_t(c);
+            hash *= 1099511628211ull;
+        }
+
+        // The low bits of FNV only depend on the low bits of the input, so the high bits are mixed down before they are used for indexing.
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Map from up to Capacity strings to values with no collisions, built at compile time with the hash and displace method.
+    // Keys are split in buckets by a first hash, and each bucket gets the seed of a second hash that sends all of its keys to free slots.
+    // Finding a key takes two hashes and one comparison.
+    template <size_t Capacity>
+    struct perfect_hash
+    {
+        static constexpr size_t slot_count = std::bit_ceil(Capacity + Capacity / 4 + 1);
+        static constexpr size_t bucket_count = Capacity / 2 + 1;
+        static constexpr uint32_t empty_slot = ~uint32_t(0);
+
+        // If a key is repeated, the first value given for it is kept.
+        constexpr explicit perfect_hash(std::span<std::string_view const> keys_, std::span<uint32_t const> values_) noexcept
+        {
+            assert(keys_.size() == values_.size());
+            assert(keys_.size() <= Capacity);
+
+            for (uint32_t & value : values)
+                value = empty_slot;
+
+            // Repeated keys are dropped once, here, by sorting the keys and keeping the first of each run.
+            size_t order[Capacity > 0 ? Capacity : 1] = {};
+            for (size_t i = 0; i < keys_.size(); ++i)
+                order[i] = i;
+            std::sort(order, order + keys_.size(), [&](size_t a, size_t b) { return keys_[a] != keys_[b] ? keys_[a] < keys_[b] : a < b; });
+
+            // Then the keys are grouped by bucket, so that placing a bucket only goes through its own keys.
+            uint32_t bucket_of_key[Capacity > 0 ? Capacity : 1] = {};
+            size_t bucket_start[bucket_count + 1] = {};
+            for (size_t k = 0; k < keys_.size(); ++k)
+            {
+                size_t const i = order[k];
+                if (k > 0 && keys_[order[k - 1]] == keys_[i])
+                    continue;
+                bucket_of_key[i] = uint32_t(string_hash(keys_[i], 0) % bucket_count);
+                ++bucket_start[bucket_of_key[i] + 1];
+            }
+
+            size_t max_bucket_size = 0;
+            for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+            {
+                max_bucket_size = std::max(max_bucket_size, bucket_start[bucket + 1]);
+                bucket_start[bucket + 1] += bucket_start[bucket];
+            }
+
+            size_t keys_by_bucket[Capacity > 0 ? Capacity : 1] = {};
+            size_t bucket_end[bucket_count] = {};
+            std::copy(bucket_start, bucket_start + bucket_count, bucket_end);
+            for (size_t k = 0; k < keys_.size(); ++k)
+            {
+                size_t const i = order[k];
+                if (k == 0 || keys_[order[k - 1]] != keys_[i])
+                    keys_by_bucket[bucket_end[bucket_of_key[i]]++] = i;
+            }
+
+            // Biggest buckets first, while there are still many free slots to choose from.
+            for (size_t size = max_bucket_size; size > 0; --size)
+                for (uint32_t bucket = 0; bucket < bucket_count; ++bucket)
+                    if (bucket_end[bucket] - bucket_start[bucket] == size)
+                        place_bucket(bucket, keys_, values_, std::span<size_t const>(keys_by_bucket + bucket_start[bucket], size));
+        }
+
+        constexpr std::optional<uint32_t> find(std::string_view key) const noexcept
+        {
+            size_t const slot = slot_of(key, displacements[string_hash(key, 0) % bucket_count]);
+            if (values[slot] != empty_slot && keys[slot] == key)
+                return values[slot];
+            else
+                return std::nullopt;
+        }
+
+        std::string_view keys[slot_count] = {};
+        uint32_t values[slot_count] = {};
+        uint32_t displacements[bucket_count] = {};
+
+    private:
+        static constexpr size_t slot_of(std::string_view key, uint32_t displacement) noexcept
+        {
+            return size_t(string_hash(key, displacement + 1) & (slot_count - 1));
+        }
+
+        constexpr void place_bucket(uint32_t bucket, std::span<std::string_view const> keys_, std::span<uint32_t const> values_, std::span<size_t const> bucket_keys) noexcept
+        {
+            for (uint32_t displacement = 0; ; ++displacement)
+            {
+                assert(displacement < 1'000'000);
+
+                bool fits = true;
+                size_t placed = 0;
+                size_t placed_slots[Capacity > 0 ? Capacity : 1] = {};
+
+                for (size_t const i : bucket_keys)
+                {
+                    size_t const slot = slot_of(keys_[i], displacement);
+                    if (values[slot] != empty_slot)
+                    {
+                        fits = false;
+                        break;
+                    }
+
+                    keys[slot] = keys_[i];
+                    values[slot] = values_[i];
+                    placed_slots[placed++] = slot;
+                }
+
+                if (fits)
+                {
+                    displacements[bucket] = displacement;
+                    return;
+                }
+
+                for (size_t i = 0; i < placed; ++i)
+                    values[placed_slots[i]] = empty_slot;
+            }
+        }
+    };
+
+} // namespace dodo
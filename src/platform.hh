@@ -0,0 +1,78 @@
+#pragma once
+
+// System functions dodo uses, for the headers that talk to the system. Windows functions are declared here with the same signatures as
+// in <windows.h>, so that including dodo neither includes <windows.h> nor defines any of its macros in the code of its users.
+
+#if defined(_WIN32)
+struct _SECURITY_ATTRIBUTES;
+struct _CONSOLE_SCREEN_BUFFER_INFO;
+union _LARGE_INTEGER;
+
+namespace dodo::detail::win32
+{
+
+    using handle = void *;
+    using dword = unsigned long;
+#if defined(_WIN64)
+    using size_type = unsigned long long;
+#else
+    using size_type = unsigned long;
+#endif
+
+    inline handle const invalid_handle_value = handle(-1);
+    constexpr dword std_output_handle = dword(-11);
+    constexpr dword generic_read = 0x80000000;
+    constexpr dword file_share_read = 0x00000001;
+    constexpr dword open_existing = 3;
+    constexpr dword file_attribute_normal = 0x00000080;
+    constexpr dword page_readonly = 0x02;
+    constexpr dword page_readwrite = 0x04;
+    constexpr dword file_map_write = 0x0002;
+    constexpr dword file_map_read = 0x0004;
+
+    // Same layout as CONSOLE_SCREEN_BUFFER_INFO.
+    struct console_screen_buffer_info
+    {
+        struct coord { short x, y; };
+        struct small_rect { short left, top, right, bottom; };
+
+        coord size;
+        coord cursor_position;
+        unsigned short attributes;
+        small_rect window;
+        coord maximum_window_size;
+    };
+
+    extern "C"
+    {
+        __declspec(dllimport) handle __stdcall CreateFileA(char const * name, dword access, dword share, ::_SECURITY_ATTRIBUTES * security,
+            dword creation, dword flags, handle template_file);
+        __declspec(dllimport) int __stdcall GetFileSizeEx(handle file, ::_LARGE_INTEGER * size);
+        __declspec(dllimport) handle __stdcall CreateFileMappingA(handle file, ::_SECURITY_ATTRIBUTES * security, dword protect,
+            dword maximum_size_high, dword maximum_size_low, char const * name);
+        __declspec(dllimport) void * __stdcall MapViewOfFile(handle mapping, dword access, dword offset_high, dword offset_low, size_type bytes);
+        __declspec(dllimport) int __stdcall UnmapViewOfFile(void const * address);
+        __declspec(dllimport) int __stdcall CloseHandle(handle object);
+        __declspec(dllimport) handle __stdcall GetStdHandle(dword which);
+        __declspec(dllimport) int __stdcall GetConsoleScreenBufferInfo(handle console, ::_CONSOLE_SCREEN_BUFFER_INFO * info);
+        __declspec(dllimport) dword __stdcall GetCurrentProcessId();
+    }
+
+    inline bool file_size(handle file, long long & size) noexcept
+    {
+        return GetFileSizeEx(file, reinterpret_cast<::_LARGE_INTEGER *>(&size)) != 0;
+    }
+
+    inline bool console_info(handle console, console_screen_buffer_info & info) noexcept
+    {
+        return GetConsoleScreenBufferInfo(console, reinterpret_cast<::_CONSOLE_SCREEN_BUFFER_INFO *>(&info)) != 0;
+    }
+
+} // namespace dodo::detail::win32
+#else
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
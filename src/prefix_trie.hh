@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+
+namespace dodo
+{
+
+    enum struct prefix_match_kind { none, exact, unique, ambiguous };
+
+    struct prefix_match
+    {
+        prefix_match_kind kind = prefix_match_kind::none;
+        uint32_t value = 0; // Value of the word found. Only meaningful for exact and unique matches.
+
+        constexpr explicit operator bool() const noexcept { return kind == prefix_match_kind::exact || kind == prefix_match_kind::unique; }
+    };
+
+    // Trie of words, each associated to a value, that can be built at compile time. Each node knows whether all words below it
+    // share the same value, so finding the word a prefix abbreviates only takes walking the prefix.
+    // Capacity is the maximum number of nodes, which is at most the total length of the words inserted plus one.
+    template <size_t Capacity>
+    struct prefix_trie
+    {
+        struct node
+        {
+            char character = '\0';
+            bool is_word_end = false;
+            bool is_ambiguous = false;  // Words with different values go through this node.
+            uint32_t word_value = 0;    // Value of the word that ends at this node.
+            uint32_t prefix_value = 0;  // Value of all words that go through this node, unless it is ambiguous.
+            uint32_t first_child = 0;   // 0 means none, since the root can't be anyone's child.
+            uint32_t next_sibling = 0;
+        };
+
+        // Inserting the same word twice keeps the value it was first inserted with.
+        // Words can be inserted below another node than the root, to keep separate sets of words in the same trie.
+        constexpr void insert(std::string_view word, uint32_t value, uint32_t root = 0) noexcept
+        {
+            uint32_t const current = add_path(word, value, root);
+            if (!nodes[current].is_word_end)
+            {
+                nodes[current].is_word_end = true;
+                nodes[current].word_value = value;
+            }
+        }
+
+        // Adds the nodes of the path without ending a word at it, and returns the last one.
+        constexpr uint32_t add_path(std::string_view path, uint32_t value, uint32_t root = 0) noexcept
+        {
+            uint32_t current = root;
+            for (char const c : path)
+            {
+                uint32_t child = find_child(current, c);
+                if (child == 0)
+                {
+                    assert(node_count < Capacity);
+                    child = node_count++;
+                    nodes[child].character = c;
+                    nodes[child].prefix_value = value;
+                    nodes[child].next_sibling = nodes[current].first_child;
+                    nodes[current].first_child = child;
+                }
+                else
+                {
+                    mark_prefix(child, value);
+                }
+
+                current = child;
+            }
+            return current;
+        }
+
+        // A word that is equal to the prefix is an exact match even if longer words start with it.
+        constexpr prefix_match find(std::string_view prefix) const noexcept
+        {
+            uint32_t const found = find_node(prefix);
+            if (found == 0)
+                return prefix_match{};
+
+            node const & n = nodes[found];
+            if (n.is_word_end)
+                return prefix_match{prefix_match_kind::exact, n.word_value};
+            else if (!n.is_ambiguous)
+                return prefix_match{prefix_match_kind::unique, n.prefix_value};
+            else
+                return prefix_match{prefix_match_kind::ambiguous, 0};
+        }
+
+        // Index of the node reached by walking the prefix from root, which is root itself for an empty prefix, or 0 if no word below root
+        // starts with the prefix.
+        constexpr uint32_t find_node(std::string_view prefix, uint32_t root = 0) const noexcept
+        {
+            uint32_t current = root;
+            for (char const c : prefix)
+            {
+                current = find_child(current, c);
+                if (current == 0)
+                    return 0;
+            }
+            return current;
+        }
+
+        node nodes[Capacity] = {};
+        uint32_t node_count = 1;
+
+    private:
+        constexpr uint32_t find_child(uint32_t parent, char c) const noexcept
+        {
+            for (uint32_t child = nodes[parent].first_child; child != 0; child = nodes[child].next_sibling)
+                if (nodes[child].character == c)
+                    return child;
+            return 0;
+        }
+
+        constexpr void mark_prefix(uint32_t index, uint32_t value) noexcept
+        {
+            if (nodes[index].prefix_value != value)
+                nodes[index].is_ambiguous = true;
+        }
+    };
+
+} // namespace dodo
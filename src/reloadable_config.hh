@@ -0,0 +1,230 @@
+#pragma once
+
+#include "dodo.hh"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__)
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace dodo
+{
+
+    // Configuration of a long running program, parsed from config files and a command line, that is parsed again when the files change.
+    // Each successful reload publishes a new immutable result with an atomic swap of a shared pointer, so readers never see a result that
+    // is being built and keep using theirs for as long as they need while newer ones are published. Taking a snapshot is not lock free:
+    // std::atomic<std::shared_ptr> takes a short internal lock on common standard libraries, and every snapshot counts a reference on
+    // the same counter. Readers on hot paths should keep their snapshot and take a new one only when version() changes.
+    // A reload that fails to parse, to pass the checks of the options, or to read a file that was there before keeps the previous snapshot.
+    // On Linux, the directories of the files are watched with inotify, so checking for changes is a single read that returns at once when
+    // nothing changed. Elsewhere, or if the files can't be watched, the modification times of the files are compared.
+    template <Parser P>
+    struct ReloadableConfig
+    {
+        using parse_result_type = typename P::parse_result_type;
+
+        // The files are given from lowest to highest precedence, and the command line takes precedence over all of them.
+        ReloadableConfig(P parser_, std::vector<std::string> paths_, Args args_ = Args());
+        ~ReloadableConfig();
+
+        ReloadableConfig(ReloadableConfig const &) = delete;
+        ReloadableConfig & operator = (ReloadableConfig const &) = delete;
+
+        // Latest configuration that parsed successfully. Null until the first successful reload.
+        std::shared_ptr<parse_result_type const> snapshot() const noexcept { return current.load(std::memory_order_acquire); }
+
+        // Number of snapshots published so far. Reading it is a lock free load, so readers can check it often and only take a new snapshot
+        // when it changes.
+        uint64_t version() const noexcept { return published.load(std::memory_order_acquire); }
+
+        // Reads the files and parses them again. Returns the error if they fail to parse, in which case the snapshot is not changed.
+        // Files that are missing in the first successful reload are treated as empty. A file that was read before and is now missing, such
+        // as one that an editor deleted to write it again, fails the reload, so that the snapshot never falls back to the defaults.
+        std::optional<std::string> reload();
+
+        // Whether any of the files has changed since the last call.
+        bool files_changed();
+
+        // Reloads if any of the files has changed. Returns the error of the reload, if there was one and it failed.
+        std::optional<std::string> reload_if_changed()
+        {
+            if (files_changed())
+                return reload();
+            return std::nullopt;
+        }
+
+        // File descriptor of the inotify instance, which becomes readable when a file changes, for waiting on it in an event loop.
+        // -1 on other platforms.
+        int native_handle() const noexcept { return watch_descriptor; }
+
+    private:
+        // The result and the text of the files it may point into, which are kept alive as long as the result is.
+        struct snapshot_data
+        {
+            std::vector<std::string> texts;
+            std::optional<parse_result_type> result;
+        };
+
+        std::optional<std::filesystem::file_time_type> write_time(std::string const & path) const;
+
+        P parser;
+        std::vector<std::string> paths;
+        Args args;
+        std::atomic<std::shared_ptr<parse_result_type const>> current;
+        std::atomic<uint64_t> published = 0;
+        std::vector<bool> read_before;
+        std::vector<std::optional<std::filesystem::file_time_type>> write_times;
+        int watch_descriptor = -1;
+    };
+
+    template <Parser P>
+    ReloadableConfig<P>::ReloadableConfig(P parser_, std::vector<std::string> paths_, Args args_)
+        : parser(std::move(parser_))
+        , paths(std::move(paths_))
+        , args(std::move(args_))
+    {
+        read_before.resize(paths.size(), false);
+        for (std::string const & path : paths)
+            write_times.push_back(write_time(path));
+
+    #if defined(__linux__)
+        watch_descriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch_descriptor >= 0)
+        {
+            // Editors often replace files instead of writing them, so the directories are watched instead of the files.
+            for (std::string const & path : paths)
+            {
+                std::filesystem::path directory = std::filesystem::path(path).parent_path();
+                if (directory.empty())
+                    directory = ".";
+                if (::inotify_add_watch(watch_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM) < 0)
+                {
+                    // Changes in a directory that is not watched would be missed, so modification times are compared instead.
+                    ::close(watch_descriptor);
+                    watch_descriptor = -1;
+                    break;
+                }
+            }
+        }
+    #endif
+    }
+
+    template <Parser P>
+    ReloadableConfig<P>::~ReloadableConfig()
+    {
+    #if defined(__linux__)
+        if (watch_descriptor >= 0)
+            ::close(watch_descriptor);
+    #endif
+    }
+
+    template <Parser P>
+    std::optional<std::string> ReloadableConfig<P>::reload()
+    {
+        auto data = std::make_shared<snapshot_data>();
+
+        // The texts are read into their final place before they are parsed, so that the views into them stay valid.
+        data->texts.resize(paths.size());
+        std::vector<bool> read(paths.size(), false);
+        std::vector<config_file> files;
+        files.reserve(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            if (std::ifstream file(paths[i], std::ios::binary); file)
+            {
+                std::ostringstream text;
+                text << file.rdbuf();
+                data->texts[i] = std::move(text).str();
+                read[i] = true;
+            }
+            else if (read_before[i])
+                return paths[i] + ": The file was removed";
+
+            auto config = config_file::parse(data->texts[i], paths[i]);
+            if (!config)
+                return std::move(config.error());
+            files.push_back(std::move(*config));
+        }
+
+        std::vector<config_file const *> layers;
+        for (config_file const & file : files)
+            layers.push_back(&file);
+        config_file const config = config_file::layered(layers);
+
+        auto parsed = parser.parse(args, value_sources(environment_lookup(), config));
+        if (!parsed)
+            return std::move(parsed.error());
+
+        data->result.emplace(std::move(*parsed));
+        parse_result_type const * const result = &*data->result;
+        current.store(std::shared_ptr<parse_result_type const>(std::move(data), result), std::memory_order_release);
+        published.fetch_add(1, std::memory_order_release);
+        read_before = std::move(read);
+        return std::nullopt;
+    }
+
+    template <Parser P>
+    bool ReloadableConfig<P>::files_changed()
+    {
+        bool changed = false;
+
+    #if defined(__linux__)
+        if (watch_descriptor >= 0)
+        {
+            // Events in the directories may be about other files, so only those with the name of one of the files count.
+            alignas(inotify_event) char buffer[4096];
+            ssize_t size;
+            while ((size = ::read(watch_descriptor, buffer, sizeof(buffer))) > 0)
+            {
+                for (char const * it = buffer; it < buffer + size; )
+                {
+                    inotify_event const * const event = reinterpret_cast<inotify_event const *>(it);
+                    // When the queue overflows, events were lost, so any of the files may have changed.
+                    if (event->mask & IN_Q_OVERFLOW)
+                        changed = true;
+                    std::string_view const name(event->name, event->len > 0 ? ::strnlen(event->name, event->len) : 0);
+                    for (std::string const & path : paths)
+                        if (!name.empty() && std::filesystem::path(path).filename() == name)
+                            changed = true;
+                    it += sizeof(inotify_event) + event->len;
+                }
+            }
+            return changed;
+        }
+    #endif
+
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            std::optional<std::filesystem::file_time_type> const time = write_time(paths[i]);
+            if (time != write_times[i])
+            {
+                write_times[i] = time;
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    template <Parser P>
+    std::optional<std::filesystem::file_time_type> ReloadableConfig<P>::write_time(std::string const & path) const
+    {
+        std::error_code error;
+        std::filesystem::file_time_type const time = std::filesystem::last_write_time(path, error);
+        if (error)
+            return std::nullopt;
+        return time;
+    }
+
+} // namespace dodo
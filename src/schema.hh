@@ -0,0 +1,196 @@
+#pragma once
+
+#include "parse_traits.hh"
+#include "sink.hh"
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+
+namespace dodo
+{
+
+    enum struct schema_format { json, cbor };
+
+    namespace detail
+    {
+        // Sink that escapes what is written to it for a JSON string.
+        template <Sink S>
+        struct json_escaping_sink
+        {
+            constexpr void write(std::string_view text)
+            {
+                constexpr char hex_digits[] = "0123456789abcdef";
+
+                size_t run_start = 0;
+                for (size_t i = 0; i < text.size(); ++i)
+                {
+                    char const c = text[i];
+                    if (c != '"' && c != '\\' && uint8_t(c) >= 0x20)
+                        continue;
+
+                    out.write(text.substr(run_start, i - run_start));
+                    run_start = i + 1;
+
+                    if (c == '"')
+                        out.write("\\\"");
+                    else if (c == '\\')
+                        out.write("\\\\");
+                    else if (c == '\n')
+                        out.write("\\n");
+                    else if (c == '\t')
+                        out.write("\\t");
+                    else if (c == '\r')
+                        out.write("\\r");
+                    else
+                    {
+                        char const escape[] = {'\\', 'u', '0', '0', hex_digits[uint8_t(c) >> 4], hex_digits[uint8_t(c) & 0xF]};
+                        out.write(std::string_view(escape, 6));
+                    }
+                }
+                out.write(text.substr(run_start));
+            }
+
+            S & out;
+        };
+    }
+
+    // Writes a schema as JSON. Values are written as strings, with the same text that help shows for them.
+    template <Sink S>
+    struct json_schema_writer
+    {
+        constexpr explicit json_schema_writer(S & sink_) noexcept : sink(sink_) {}
+
+        constexpr void begin_object(std::string_view key) { begin_value(key); sink.write("{"); push(); }
+        constexpr void end_object() { pop(); sink.write("}"); }
+        constexpr void begin_array(std::string_view key) { begin_value(key); sink.write("["); push(); }
+        constexpr void end_array() { pop(); sink.write("]"); }
+
+        constexpr void string(std::string_view key, std::string_view text)
+        {
+            begin_value(key);
+            sink.write("\"");
+            detail::json_escaping_sink<S>{sink}.write(text);
+            sink.write("\"");
+        }
+
+        template <typename T>
+        constexpr void value(std::string_view key, T const & t)
+        {
+            begin_value(key);
+            sink.write("\"");
+            detail::json_escaping_sink<S> escaped{sink};
+            write_value(escaped, t);
+            sink.write("\"");
+        }
+
+        constexpr void boolean(std::string_view key, bool b)
+        {
+            begin_value(key);
+            sink.write(b ? "true" : "false");
+        }
+
+    private:
+        static constexpr size_t max_depth = 64;
+
+        constexpr void begin_value(std::string_view key)
+        {
+            if (depth > 0)
+            {
+                if (!is_first[depth - 1])
+                    sink.write(",");
+                is_first[depth - 1] = false;
+            }
+
+            if (!key.empty())
+            {
+                sink.write("\"");
+                sink.write(key);
+                sink.write("\":");
+            }
+        }
+
+        constexpr void push() noexcept
+        {
+            assert(depth < max_depth);
+            is_first[depth++] = true;
+        }
+
+        constexpr void pop() noexcept { --depth; }
+
+        S & sink;
+        bool is_first[max_depth] = {};
+        size_t depth = 0;
+    };
+
+    // Writes a schema as CBOR (RFC 8949), with the same structure as JSON. Objects and arrays have indefinite length, so they can be
+    // written as the parser is walked.
+    template <Sink S>
+    struct cbor_schema_writer
+    {
+        constexpr explicit cbor_schema_writer(S & sink_) noexcept : sink(sink_) {}
+
+        constexpr void begin_object(std::string_view key) { write_key(key); write_byte(0xBF); }
+        constexpr void end_object() { write_byte(0xFF); }
+        constexpr void begin_array(std::string_view key) { write_key(key); write_byte(0x9F); }
+        constexpr void end_array() { write_byte(0xFF); }
+
+        constexpr void string(std::string_view key, std::string_view text)
+        {
+            write_key(key);
+            write_text(text);
+        }
+
+        template <typename T>
+        constexpr void value(std::string_view key, T const & t)
+        {
+            write_key(key);
+            counting_sink size;
+            write_value(size, t);
+            write_head(3, size.size);
+            write_value(sink, t);
+        }
+
+        constexpr void boolean(std::string_view key, bool b)
+        {
+            write_key(key);
+            write_byte(b ? 0xF5 : 0xF4);
+        }
+
+    private:
+        constexpr void write_byte(uint8_t byte)
+        {
+            char const c = char(byte);
+            sink.write(std::string_view(&c, 1));
+        }
+
+        constexpr void write_head(uint8_t major_type, uint64_t argument)
+        {
+            uint8_t const type = uint8_t(major_type << 5);
+            if (argument < 24)
+            {
+                write_byte(uint8_t(type | argument));
+                return;
+            }
+
+            int const byte_count = argument <= 0xFF ? 1 : argument <= 0xFFFF ? 2 : argument <= 0xFFFFFFFF ? 4 : 8;
+            write_byte(uint8_t(type | (byte_count == 1 ? 24 : byte_count == 2 ? 25 : byte_count == 4 ? 26 : 27)));
+            for (int i = byte_count - 1; i >= 0; --i)
+                write_byte(uint8_t(argument >> (8 * i)));
+        }
+
+        constexpr void write_text(std::string_view text)
+        {
+            write_head(3, text.size());
+            sink.write(text);
+        }
+
+        constexpr void write_key(std::string_view key)
+        {
+            if (!key.empty())
+                write_text(key);
+        }
+
+        S & sink;
+    };
+
+} // namespace dodo
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace dodo
+{
+
+    // Destination for text that is written in fragments, such as help text.
+    template <typename S>
+    concept Sink = requires(S & sink, std::string_view text) { sink.write(text); };
+
+    // Sink that appends to a string.
+    struct string_sink
+    {
+        constexpr void write(std::string_view text) { out.append(text); }
+
+        std::string & out;
+    };
+
+    struct ostream_sink
+    {
+        void write(std::string_view text) { out.write(text.data(), std::streamsize(text.size())); }
+
+        std::ostream & out;
+    };
+
+    // Sink that writes to a file descriptor, such as 1 for the standard output. Text is buffered, and written when the buffer is full,
+    // when flush is called and when the sink is destroyed, so that text written in many small fragments takes few system calls.
+    struct file_descriptor_sink
+    {
+        explicit file_descriptor_sink(int file_descriptor_) noexcept : file_descriptor(file_descriptor_) {}
+        file_descriptor_sink(file_descriptor_sink const &) = delete;
+        file_descriptor_sink & operator = (file_descriptor_sink const &) = delete;
+        ~file_descriptor_sink() { flush(); }
+
+        void write(std::string_view text) noexcept
+        {
+            if (text.size() > sizeof(buffer) - size)
+            {
+                flush();
+                // Text that doesn't fit in the buffer is written directly instead of in pieces.
+                if (text.size() >= sizeof(buffer))
+                {
+                    write_all(text);
+                    return;
+                }
+            }
+            std::copy(text.begin(), text.end(), buffer + size);
+            size += text.size();
+        }
+
+        // Writes the buffered text. Returns false if any text could not be written, since this or any earlier call.
+        bool flush() noexcept
+        {
+            write_all(std::string_view(buffer, size));
+            size = 0;
+            return !failed;
+        }
+
+        int file_descriptor;
+
+    private:
+        // Writes all of text, resuming after short writes and writes interrupted by signals.
+        void write_all(std::string_view text) noexcept
+        {
+            while (!text.empty() && !failed)
+            {
+            #if defined(_WIN32)
+                int const written = ::_write(file_descriptor, text.data(), unsigned(std::min<size_t>(text.size(), 1u << 30)));
+            #else
+                auto const written = ::write(file_descriptor, text.data(), text.size());
+            #endif
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    failed = true;
+                else
+                    text.remove_prefix(size_t(written));
+            }
+        }
+
+        char buffer[4096];
+        size_t size = 0;
+        bool failed = false;
+    };
+
+    // Sink that writes to a fixed buffer. Text that does not fit is discarded, and truncated is set.
+    struct buffer_sink
+    {
+        constexpr explicit buffer_sink(std::span<char> buffer_) noexcept : buffer(buffer_) {}
+
+        constexpr void write(std::string_view text) noexcept
+        {
+            size_t const available = buffer.size() - size;
+            if (text.size() > available)
+            {
+                text = text.substr(0, available);
+                truncated = true;
+            }
+
+            for (char const c : text)
+                buffer[size++] = c;
+        }
+
+        constexpr std::string_view view() const noexcept { return std::string_view(buffer.data(), size); }
+
+        std::span<char> buffer;
+        size_t size = 0;
+        bool truncated = false;
+    };
+
+    // Sink that only counts the characters written to it, for sizing buffers.
+    struct counting_sink
+    {
+        constexpr void write(std::string_view text) noexcept { size += text.size(); }
+
+        size_t size = 0;
+    };
+
+    // Sink that only computes the FNV-1a hash of the characters written to it, for fingerprinting text with no buffer.
+    struct hashing_sink
+    {
+        constexpr void write(std::string_view text) noexcept
+        {
+            for (char const c : text)
+            {
+                hash ^= uint8_t(c);
+                hash *= 1099511628211ull;
+            }
+        }
+
+        uint64_t hash = 14695981039346656037ull;
+    };
+
+    // Text of a fixed size that can be built at compile time, so that it lives in read only memory.
+    template <size_t Capacity>
+    struct static_text
+    {
+        constexpr void write(std::string_view text) noexcept
+        {
+            for (char const c : text)
+                data[size++] = c;
+        }
+
+        constexpr std::string_view view() const noexcept { return std::string_view(data, size); }
+
+        char data[Capacity > 0 ? Capacity : 1] = {};
+        size_t size = 0;
+    };
+
+    template <Sink S>
+    constexpr void write_spaces(S & sink, size_t count)
+    {
+        constexpr std::string_view spaces = "                                                                ";
+        while (count > spaces.size())
+        {
+            sink.write(spaces);
+            count -= spaces.size();
+        }
+        sink.write(spaces.substr(0, count));
+    }
+
+    // Sink that writes to the given destination, which may be a string, an output stream or a sink.
+    inline string_sink sink_for(std::string & out) noexcept { return string_sink{out}; }
+    inline ostream_sink sink_for(std::ostream & out) noexcept { return ostream_sink{out}; }
+
+    template <Sink S>
+    constexpr S & sink_for(S & sink) noexcept { return sink; }
+
+} // namespace dodo
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dodo
+{
+
+    // Set of the bigrams of a text, hashed into the bits of a 64 bit integer. Each edit destroys at most two bigrams, so if two texts are
+    // at edit distance k, each of their signatures has at most 2k bits that the other lacks. Collisions only make this bound looser.
+    constexpr uint64_t bigram_signature(std::string_view text) noexcept
+    {
+        uint64_t signature = 0;
+        for (size_t i = 1; i < text.size(); ++i)
+        {
+            uint32_t const bigram = uint32_t(uint8_t(text[i - 1])) * 31u + uint32_t(uint8_t(text[i]));
+            signature |= uint64_t(1) << ((bigram * 2654435761u) >> 26);
+        }
+        return signature;
+    }
+
+    namespace detail
+    {
+        // Classic dynamic programming for texts too long for the bit-parallel kernel.
+        constexpr size_t bounded_edit_distance_dp(std::string_view a, std::string_view b, size_t max_distance) noexcept
+        {
+            std::vector<size_t> row(b.size() + 1);
+            for (size_t j = 0; j <= b.size(); ++j)
+                row[j] = j;
+
+            for (size_t i = 1; i <= a.size(); ++i)
+            {
+                size_t diagonal = row[0];
+                row[0] = i;
+                size_t row_minimum = row[0];
+
+                for (size_t j = 1; j <= b.size(); ++j)
+                {
+                    size_t const above = row[j];
+                    row[j] = std::min({above + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+                    diagonal = above;
+                    row_minimum = std::min(row_minimum, row[j]);
+                }
+
+                if (row_minimum > max_distance)
+                    return max_distance + 1;
+            }
+
+            return std::min(row[b.size()], max_distance + 1);
+        }
+    }
+
+    // Levenshtein distance between a and b if it is at most max_distance, or max_distance + 1 otherwise.
+    // Uses Myers' bit-parallel algorithm, which computes 64 cells of the dynamic programming matrix with a handful of word operations,
+    // and stops as soon as the distance is known to exceed the bound.
+    constexpr size_t bounded_edit_distance(std::string_view a, std::string_view b, size_t max_distance) noexcept
+    {
+        if (a.size() > b.size())
+            std::swap(a, b);
+
+        if (b.size() - a.size() > max_distance)
+            return max_distance + 1;
+        if (a.empty())
+            return b.size();
+        if (a.size() > 64)
+            return detail::bounded_edit_distance_dp(a, b, max_distance);
+
+        uint64_t pattern_mask[256] = {};
+        for (size_t i = 0; i < a.size(); ++i)
+            pattern_mask[uint8_t(a[i])] |= uint64_t(1) << i;
+
+        uint64_t const last_bit = uint64_t(1) << (a.size() - 1);
+        uint64_t vertical_positive = ~uint64_t(0);
+        uint64_t vertical_negative = 0;
+        size_t distance = a.size();
+
+        for (size_t j = 0; j < b.size(); ++j)
+        {
+            uint64_t const equal = pattern_mask[uint8_t(b[j])];
+            uint64_t const x_vertical = equal | vertical_negative;
+            uint64_t const x_horizontal = (((equal & vertical_positive) + vertical_positive) ^ vertical_positive) | equal;
+            uint64_t horizontal_positive = vertical_negative | ~(x_horizontal | vertical_positive);
+            uint64_t horizontal_negative = vertical_positive & x_horizontal;
+
+            if (horizontal_positive & last_bit)
+                ++distance;
+            else if (horizontal_negative & last_bit)
+                --distance;
+
+            // Each remaining character can lower the distance by at most one.
+            if (distance > max_distance + (b.size() - j - 1))
+                return max_distance + 1;
+
+            horizontal_positive = (horizontal_positive << 1) | 1;
+            horizontal_negative = horizontal_negative << 1;
+            vertical_positive = horizontal_negative | ~(x_vertical | horizontal_positive);
+            vertical_negative = horizontal_positive & x_vertical;
+        }
+
+        return std::min(distance, max_distance + 1);
+    }
+
+    // Edits allowed for a candidate to be suggested. Short texts allow less edits, or everything would be a suggestion.
+    constexpr size_t default_max_suggestion_distance(std::string_view text) noexcept
+    {
+        return text.size() <= 4 ? 1 : 2;
+    }
+
+    // Finds the candidates closest to a misspelled text. Candidates are first discarded by length and by bigram signature,
+    // so the edit distance is only computed for plausible ones.
+    struct suggestion_collector
+    {
+        explicit suggestion_collector(std::string_view text_, size_t max_distance_) noexcept
+            : text(text_)
+            , text_signature(bigram_signature(text_))
+            , max_distance(max_distance_)
+        {}
+
+        explicit suggestion_collector(std::string_view text_) noexcept
+            : suggestion_collector(text_, default_max_suggestion_distance(text_))
+        {}
+
+        void consider(std::string_view candidate, uint64_t candidate_signature)
+        {
+            size_t const length_difference = candidate.size() > text.size() ? candidate.size() - text.size() : text.size() - candidate.size();
+            if (length_difference > max_distance)
+                return;
+
+            if (size_t(std::popcount(text_signature & ~candidate_signature)) > 2 * max_distance ||
+                size_t(std::popcount(candidate_signature & ~text_signature)) > 2 * max_distance)
+                return;
+
+            size_t const distance = bounded_edit_distance(text, candidate, max_distance);
+            if (distance > max_distance)
+                return;
+
+            // Only the closest candidates are kept, so the bound can be tightened.
+            if (distance < max_distance)
+            {
+                suggestions.clear();
+                max_distance = distance;
+            }
+
+            if (std::find(suggestions.begin(), suggestions.end(), candidate) == suggestions.end())
+                suggestions.push_back(candidate);
+        }
+
+        void consider(std::string_view candidate)
+        {
+            consider(candidate, bigram_signature(candidate));
+        }
+
+        // "\nDid you mean ...?" if there is any suggestion or an empty string otherwise.
+        std::string did_you_mean() const
+        {
+            if (suggestions.empty())
+                return std::string();
+
+            std::string out = suggestions.size() == 1 ? "\nDid you mean " : "\nDid you mean one of ";
+            for (size_t i = 0; i < suggestions.size(); ++i)
+            {
+                if (i > 0)
+                    out += ", ";
+                out += '"';
+                out += suggestions[i];
+                out += '"';
+            }
+            out += '?';
+            return out;
+        }
+
+        std::string_view text;
+        uint64_t text_signature;
+        size_t max_distance;
+        std::vector<std::string_view> suggestions;
+    };
+
+    // Words with their bigram signatures precomputed, which can be built at compile time.
+    template <size_t Capacity>
+    struct suggestion_index
+    {
+        struct entry
+        {
+            std::string_view word;
+            uint64_t signature = 0;
+        };
+
+        constexpr void insert(std::string_view word) noexcept
+        {
+            insert(word, bigram_signature(word));
+        }
+
+        constexpr void insert(std::string_view word, uint64_t signature) noexcept
+        {
+            entries[size++] = entry{word, signature};
+        }
+
+        std::vector<std::string_view> suggest(std::string_view text) const
+        {
+            return suggest(text, default_max_suggestion_distance(text));
+        }
+
+        std::vector<std::string_view> suggest(std::string_view text, size_t max_distance) const
+        {
+            suggestion_collector collector(text, max_distance);
+            for (size_t i = 0; i < size; ++i)
+                collector.consider(entries[i].word, entries[i].signature);
+            return std::move(collector.suggestions);
+        }
+
+        entry entries[Capacity > 0 ? Capacity : 1] = {};
+        size_t size = 0;
+    };
+
+} // namespace dodo
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "platform.hh"
+#include <charconv>
+#include <cstddef>
+#include <cstdlib>
+#include <string_view>
+
+namespace dodo
+{
+
+    // Width in columns of the terminal the standard output is connected to. The COLUMNS environment variable takes precedence, as it is
+    // what shells use to say the width of the terminal to their children. Otherwise, the width is that of the terminal or the Windows
+    // console. Returns 0 if the width is not known, for example when the output is redirected to a file.
+    inline size_t terminal_width() noexcept
+    {
+    #if defined(_MSC_VER)
+        char * columns = nullptr;
+        size_t columns_size = 0;
+        if (_dupenv_s(&columns, &columns_size, "COLUMNS") == 0 && columns != nullptr)
+        {
+            std::string_view const text = columns;
+            size_t width = 0;
+            auto const result = std::from_chars(text.data(), text.data() + text.size(), width);
+            std::free(columns);
+            if (result.ec == std::errc() && width > 0)
+                return width;
+        }
+    #else
+        if (char const * const columns = std::getenv("COLUMNS"))
+        {
+            std::string_view const text = columns;
+            size_t width = 0;
+            auto const result = std::from_chars(text.data(), text.data() + text.size(), width);
+            if (result.ec == std::errc() && width > 0)
+                return width;
+        }
+    #endif
+
+    #if defined(_WIN32)
+        // cmd and PowerShell don't set COLUMNS, so the width is that of the visible window of the console.
+        detail::win32::console_screen_buffer_info info = {};
+        if (detail::win32::console_info(detail::win32::GetStdHandle(detail::win32::std_output_handle), info) && info.window.right >= info.window.left)
+            return size_t(info.window.right - info.window.left + 1);
+    #else
+        winsize size = {};
+        if (::isatty(STDOUT_FILENO) && ::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0)
+            return size.ws_col;
+    #endif
+
+        return 0;
+    }
+
+} // namespace dodo
@@ -0,0 +1,25 @@
+// Answers the completion requests of the scripts made by dodo::write_completion_script from a completion file, so that completing a
+// command line does not need to start the program it is for. The scripts call it as
+//
+//     dodo_complete <completion file> __complete <command line up to the cursor>
+//
+// and it writes the candidates for the last word of the command line, one per line.
+
+#include "../src/completion.hh"
+#include "../src/completion_file.hh"
+
+int main(int argc, char const * argv[])
+{
+    if (argc < 3)
+        return 2;
+
+    dodo::mapped_file const file(argv[1]);
+    if (!file)
+        return 1;
+
+    std::optional<dodo::completion_file> const completions = dodo::completion_file::from_bytes(file.bytes());
+    if (!completions)
+        return 1;
+
+    return dodo::answer_completion_request(*completions, dodo::Args(argc - 1, argv + 1), dodo::file_descriptor_sink{1}) ? 0 : 2;
+}